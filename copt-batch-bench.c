@@ -0,0 +1,150 @@
+/* copt-batch-bench.c - copt_parse_batch() throughput across threads
+   https://github.com/fardaniqbal/copt/
+
+   Parses many short command lines against one shared copt_tab, split
+   evenly among 1, 2, 4, ... threads.  Prints CSV rows in the same format
+   as copt-bench.c, where loop is threadsN and ns_per_arg is wall time. */
+#define _POSIX_C_SOURCE 200112L
+#include "copt.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+# define LANG "c++"
+#else
+# define LANG "c"
+#endif
+
+enum { NLINE = 100000, LINELEN = 10, MAXTHREAD = 64, ROUNDS = 5 };
+
+static const char *const specs[] = {
+  "v|verbose", "q|quiet", "c|color", "o|output", "s|size", "j|jobs",
+  "n|dry-run", "f|force", "I|include", "W|warn"
+};
+static const unsigned char kinds[] = {
+  COPT_ARG_NONE, COPT_ARG_NONE, COPT_ARG_OPTIONAL, COPT_ARG_REQUIRED,
+  COPT_ARG_REQUIRED, COPT_ARG_REQUIRED, COPT_ARG_NONE, COPT_ARG_NONE,
+  COPT_ARG_REQUIRED, COPT_ARG_OPTIONAL
+};
+static const char *const pool[] = {
+  "-v", "-qf", "--verbose", "--color=auto", "-o", "out.o", "--size=4k",
+  "-Iinclude", "--dry-run", "file.c", "--warn=all", "-j", "4", "main.c"
+};
+
+static char *lines[NLINE][LINELEN+1];
+static char *const *argvs[NLINE];
+static struct copt_tab tab;
+
+struct worker {
+  pthread_t thread;
+  int first, nline;
+  long nrec;
+  struct copt_rec recs[4096];
+  int ends[4096];
+};
+static struct worker workers[MAXTHREAD];
+
+/* Fill lines with LINELEN synthetic args each, after the program name. */
+static void
+mklines(void)
+{
+  const int npool = (int) (sizeof pool / sizeof *pool);
+  unsigned long rnd = 1;
+  int i, j;
+  for (i = 0; i < NLINE; i++) {
+    lines[i][0] = (char *) "job";
+    for (j = 1; j < LINELEN; j++) {
+      rnd = (rnd * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      lines[i][j] = (char *) pool[(rnd >> 12) % npool];
+    }
+    lines[i][LINELEN] = NULL;
+    argvs[i] = lines[i];
+  }
+}
+
+/* Parse worker's lines in batches that fit in its record array. */
+static void *
+work(void *arg)
+{
+  struct worker *w = (struct worker *) arg;
+  const char *nonopts[LINELEN];
+  int i = 0, n;
+  w->nrec = 0;
+  while (i < w->nline) {
+    n = copt_parse_batch(&tab, kinds, w->nline - i, argvs + w->first + i,
+                         nonopts, LINELEN, w->recs, 4096, w->ends);
+    if (n <= 0)       /* line needs more records than RECS holds */
+      exit((fprintf(stderr, "line %d too long\n", w->first + i), 1));
+    w->nrec += w->ends[n-1];
+    i += n;
+  }
+  return NULL;
+}
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Print CSV row for parsing all lines with NTHREAD threads. */
+static void
+run(int nthread)
+{
+  double best = 0, start, ns;
+  int round, i;
+  for (round = 0; round < ROUNDS; round++) {
+    start = now_ns();
+    for (i = 0; i < nthread; i++) {
+      workers[i].first = (int) ((long) NLINE * i / nthread);
+      workers[i].nline = (int) ((long) NLINE * (i+1) / nthread) -
+                         workers[i].first;
+      if (pthread_create(&workers[i].thread, NULL, work, &workers[i]))
+        exit((fprintf(stderr, "can't create thread\n"), 1));
+    }
+    for (i = 0; i < nthread; i++)
+      pthread_join(workers[i].thread, NULL);
+    ns = now_ns() - start;
+    if (round == 0 || ns < best)
+      best = ns;
+  }
+  ns = best / ((double) NLINE * LINELEN);
+  printf("copt-batch,%s,mixed,const,threads%d,%d,%.2f,%.2f\n", LANG,
+         nthread, NLINE * LINELEN, ns, 1e3 / ns);
+  fflush(stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static struct copt_slot slots[32];
+  int header = 1, max_threads = 8, n;
+  struct copt opt = copt_init(argc, argv, 1);
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "t|max-threads")) {
+      max_threads = atoi(copt_arg(&opt));
+    } else if (copt_opt(&opt, "no-header")) {
+      header = 0;
+    } else {
+      fprintf(stderr, "usage: %s [--max-threads=N] [--no-header]\n",
+              COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
+  if (max_threads < 1 || max_threads > MAXTHREAD)
+    return fprintf(stderr, "max threads must be 1 to %d\n", MAXTHREAD), 2;
+  if (copt_tab_init(&tab, specs, (int) (sizeof specs / sizeof *specs),
+                    slots, 32) != 0)
+    return fprintf(stderr, "copt_tab_init() failed\n"), 1;
+  mklines();
+  if (header)
+    printf("bench,lang,layout,mode,loop,nargs,ns_per_arg,margs_per_s\n");
+  for (n = 1; n <= max_threads; n *= 2)
+    run(n);
+  return 0;
+}
@@ -0,0 +1,352 @@
+/* copt-bench.c - benchmarks for copt library's parsing hot path
+   https://github.com/fardaniqbal/copt/
+
+   Prints CSV rows with columns:
+
+   bench   - name of benchmark program
+   lang    - whether copt was compiled as c or c++
+   layout  - optsfirst: options, then non-options (the only layout that
+             reorder=0 fully parses); mixed: every 4th arg is a non-option
+   mode    - reorder=0, reorder=1, reorder=1+scratch (copt_set_scratch),
+             const (copt_init_const, which reorders without touching
+             argv), or nonoptfn (copt_set_nonoptfn, which passes each
+             non-option to a callback as it's met)
+   loop    - next: only copt_next() over options without separate args;
+             opt: same args, plus a copt_opt() chain per option; arg: args
+             include options with separate args, and loop also calls
+             copt_arg()/copt_oarg() as needed; bind: same args, parsed
+             with copt_bind() instead of a loop; chainN: every arg is a
+             --long=ARG option matching the last of N copt_opt() calls;
+             complete: copt_complete() queries on a table of nargs
+             optspecs, timed per query; names: copt_names_init() building
+             that table, timed per optspec
+   nargs   - number of args in synthetic command line
+   ns_per_arg, margs_per_s - average time per arg, and its inverse
+
+   reorder=1 without scratch takes quadratic time on the mixed layout, so
+   it's skipped there above 100000 args. */
+#include "copt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+# define LANG "c++"
+#else
+# define LANG "c"
+#endif
+
+enum layout { OPTSFIRST, MIXED };
+enum loop { LOOP_NEXT, LOOP_OPT, LOOP_ARG, LOOP_BIND };
+static const char *const layout_names[] = {"optsfirst", "mixed"};
+static const char *const loop_names[] = {"next", "opt", "arg", "bind"};
+static const char *const mode_names[] = {
+  "reorder=0", "reorder=1", "reorder=1+scratch", "const", "nonoptfn"
+};
+
+/* Options with no separate arg, so any loop parses them the same way. */
+static const char *const flag_pool[] = {
+  "-v", "-xvz", "--verbose", "--quiet", "--color=auto", "-c", "-nf",
+  "--output=out.o", "--size=4k", "-Iinclude", "--dry-run", "--force",
+  "--warn=all", "-qz"
+};
+
+/* Options followed by a separate arg. */
+static const char *const arg_pool[][2] = {
+  {"-o", "out.o"}, {"--size", "10"}, {"-j", "4"}, {"--include", "dir"}
+};
+
+static volatile unsigned long sink; /* keep results from being optimized */
+
+/* Fill ARGV with N synthetic args in LAYOUT.  If WITH_ARGS is false, only
+   use options that don't take a separate arg. */
+static void
+mkargs(char **argv, int n, enum layout layout, int with_args)
+{
+  const int nflag = (int) (sizeof flag_pool / sizeof *flag_pool);
+  const int npair = (int) (sizeof arg_pool / sizeof *arg_pool);
+  unsigned long rnd = 1;
+  int i = 0, nonopt_start = layout == OPTSFIRST ? n - n/4 : n;
+  argv[i++] = (char *) "bench";
+  while (i < n) {
+    rnd = (rnd * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    if (i >= nonopt_start || (layout == MIXED && i % 4 == 0)) {
+      argv[i++] = (char *) "file.c";
+    } else if (with_args && (rnd >> 8) % 4 == 0 && i+1 < nonopt_start) {
+      argv[i++] = (char *) arg_pool[(rnd >> 12) % npair][0];
+      argv[i++] = (char *) arg_pool[(rnd >> 12) % npair][1];
+    } else {
+      argv[i++] = (char *) flag_pool[(rnd >> 12) % nflag];
+    }
+  }
+}
+
+/* Destinations for LOOP_BIND, using the same optspecs as parse()'s loop. */
+static int bind_flag, bind_int;
+static char *bind_str;
+static const struct copt_bind binds[] = {
+  {"v|verbose", COPT_BIND_COUNT, &bind_int}, {"x", COPT_BIND_FLAG, &bind_flag},
+  {"z", COPT_BIND_FLAG, &bind_flag}, {"q|quiet", COPT_BIND_FLAG, &bind_flag},
+  {"c|color", COPT_BIND_OSTR, &bind_str},
+  {"o|output", COPT_BIND_STR, &bind_str},
+  {"s|size", COPT_BIND_STR, &bind_str}, {"j|jobs", COPT_BIND_INT, &bind_int},
+  {"n|dry-run", COPT_BIND_FLAG, &bind_flag},
+  {"f|force", COPT_BIND_FLAG, &bind_flag},
+  {"I|include", COPT_BIND_STR, &bind_str},
+  {"W|warn", COPT_BIND_OSTR, &bind_str}
+};
+static struct copt_slot bind_slots[32];
+static struct copt_tab bind_tab; /* from binds, built once by main() */
+
+/* Count non-options passed to copt_set_nonoptfn() callback. */
+static void
+count_nonopt(const struct copt *opt, char *arg, void *aux)
+{
+  ++*(int *) aux;
+  (void) opt, (void) arg;
+}
+
+/* Parse ARGC args in ARGV using LOOP.  Return number of non-options. */
+static int
+parse(enum loop loop, int argc, char **argv, int mode, char **scratch)
+{
+  unsigned long sum = 0;
+  int nonopts = 0;
+  struct copt opt = mode == 3 ?
+    copt_init_const(argc, (const char *const *) argv,
+                    (const char **) scratch, argc) :
+    copt_init(argc, argv, mode != 0);
+  if (mode == 2)
+    copt_set_scratch(&opt, scratch, argc);
+  if (mode == 4)
+    copt_set_nonoptfn(&opt, count_nonopt, &nonopts);
+  while (loop == LOOP_BIND && copt_bind(&opt, binds, &bind_tab) == 1)
+    sum += 7;                   /* unknown option */
+  while (loop != LOOP_BIND && copt_next(&opt)) {
+    if (loop == LOOP_NEXT) {
+      sum++;
+    } else if (copt_opt(&opt, "v|verbose")) {
+      sum += 1;
+    } else if (copt_opt(&opt, "x")) {
+      sum += 2;
+    } else if (copt_opt(&opt, "z")) {
+      sum += 3;
+    } else if (copt_opt(&opt, "q|quiet")) {
+      sum += 4;
+    } else if (copt_opt(&opt, "c|color")) {
+      sum += !!copt_oarg(&opt);
+    } else if (copt_opt(&opt, "o|output")) {
+      sum += !!copt_arg(&opt);
+    } else if (copt_opt(&opt, "s|size")) {
+      sum += !!copt_arg(&opt);
+    } else if (copt_opt(&opt, "j|jobs")) {
+      sum += !!copt_arg(&opt);
+    } else if (copt_opt(&opt, "n|dry-run")) {
+      sum += 5;
+    } else if (copt_opt(&opt, "f|force")) {
+      sum += 6;
+    } else if (copt_opt(&opt, "I|include")) {
+      sum += !!copt_arg(&opt);
+    } else if (copt_opt(&opt, "W|warn")) {
+      sum += !!copt_oarg(&opt);
+    } else {
+      sum += 7;
+    }
+  }
+  sink += sum;
+  return nonopts + copt_nonopt_count(&opt);
+}
+
+/* Parse ARGC args in ARGV, all options, with a chain of NSPEC copt_opt()
+   calls over SPECS per option. */
+static void
+parse_chain(int argc, char **argv, char **specs, int nspec)
+{
+  unsigned long sum = 0;
+  struct copt opt = copt_init(argc, argv, 0);
+  int i;
+  while (copt_next(&opt)) {
+    for (i = 0; i < nspec && !copt_opt(&opt, specs[i]); i++)
+      continue;
+    sum += i + !!copt_oarg(&opt);
+  }
+  sink += sum;
+}
+
+/* Print CSV rows for option chains of increasing length.  The cost per
+   copt_opt() call should stay flat even though each arg is fairly long. */
+static void
+run_chains(int argc, char **src, char **work)
+{
+  enum { MAXSPEC = 64 };
+  static char names[MAXSPEC][24], arg[128];
+  char *specs[MAXSPEC];
+  clock_t start, now;
+  double ns;
+  long iters;
+  int i, nspec;
+  for (i = 0; i < MAXSPEC; i++) {
+    sprintf(names[i], "chain-option-%02d", i);
+    specs[i] = names[i];
+  }
+  for (nspec = 1; nspec <= MAXSPEC; nspec *= 4) {
+    sprintf(arg, "--%s=/some/fairly/long/path/to/a/file/used/as/optarg.txt",
+            specs[nspec-1]);
+    src[0] = (char *) "bench";
+    for (i = 1; i < argc; i++)
+      src[i] = arg;
+    start = clock();
+    iters = 0;
+    do {
+      memcpy(work, src, argc * sizeof *work);
+      parse_chain(argc, work, specs, nspec);
+      iters++;
+    } while ((now = clock()) - start < CLOCKS_PER_SEC / 10);
+    ns = (double) (now - start) / CLOCKS_PER_SEC * 1e9 / iters / argc;
+    printf("copt,%s,optsfirst,reorder=0,chain%d,%d,%.2f,%.2f\n", LANG,
+           nspec, argc, ns, 1e3 / ns);
+    fflush(stdout);
+  }
+}
+
+/* Print CSV rows for shell completion with NSPEC optspecs: building the
+   sorted table at startup, then completing typical words, each after a
+   few earlier words that copt_complete() has to parse. */
+static void
+run_complete(int nspec)
+{
+  enum { MAXSPEC = 1000 };
+  static const char *const stems[] = {
+    "warn", "link", "include", "define", "target", "debug", "emit", "opt"
+  };
+  static const char *const queries[][5] = {
+    {"cc", "-O2", "--", NULL}, {"cc", "-o", "a.out", "--link-00", NULL},
+    {"cc", "file.c", "-", NULL}, {"cc", "--define-007=x", NULL},
+    {"cc", "-x", "--include-004", "dir", NULL}, {"cc", "-ofi", NULL}
+  };
+  static char bufs[MAXSPEC][24];
+  static const char *specs[MAXSPEC];
+  static unsigned char kinds[MAXSPEC];
+  static struct copt_slot names[MAXSPEC*2];
+  const int nquery = (int) (sizeof queries / sizeof *queries);
+  unsigned long sum = 0;
+  clock_t start, now;
+  double ns;
+  long iters;
+  int i, at, argc, nname = 0;
+  nspec = nspec < MAXSPEC ? nspec : MAXSPEC;
+  for (i = 0; i < nspec; i++) {
+    if (i < 26)
+      sprintf(bufs[i], "%c|%s-%03d", 'a' + i, stems[i % 8], i / 8);
+    else
+      sprintf(bufs[i], "%s-%03d", stems[i % 8], i / 8);
+    specs[i] = bufs[i];
+    kinds[i] = i % 3 == 0 ? COPT_ARG_NONE : COPT_ARG_REQUIRED;
+  }
+  start = clock();
+  iters = 0;
+  do {
+    nname = copt_names_init(specs, nspec, names, MAXSPEC*2);
+    iters++;
+  } while ((now = clock()) - start < CLOCKS_PER_SEC / 10);
+  ns = (double) (now - start) / CLOCKS_PER_SEC * 1e9 / iters / nspec;
+  printf("copt,%s,optsfirst,reorder=0,names,%d,%.2f,%.2f\n", LANG, nspec,
+         ns, 1e3 / ns);
+  start = clock();
+  iters = 0;
+  do {
+    for (i = 0; i < nquery; i++) {
+      for (argc = 0; queries[i][argc] != NULL; argc++)
+        continue;
+      sum += copt_complete(names, nname, kinds, argc, (char **) queries[i],
+                           &at) + at;
+    }
+    iters += nquery;
+  } while ((now = clock()) - start < CLOCKS_PER_SEC / 10);
+  ns = (double) (now - start) / CLOCKS_PER_SEC * 1e9 / iters;
+  printf("copt,%s,optsfirst,reorder=0,complete,%d,%.2f,%.2f\n", LANG, nspec,
+         ns, 1e3 / ns);
+  fflush(stdout);
+  sink += sum;
+}
+
+/* Print CSV row for parsing ARGC args in SRC with LOOP in MODE.  Repeat
+   for at least 0.1 seconds.  Time includes copying SRC to WORK, since
+   reordering modifies it, but that's negligible next to parsing. */
+static void
+run(enum layout layout, enum loop loop, int mode,
+    int argc, char **src, char **work, char **scratch)
+{
+  clock_t start = clock(), now;
+  double ns;
+  long iters = 0;
+  do {
+    memcpy(work, src, argc * sizeof *work);
+    parse(loop, argc, work, mode, scratch);
+    iters++;
+  } while ((now = clock()) - start < CLOCKS_PER_SEC / 10);
+  ns = (double) (now - start) / CLOCKS_PER_SEC * 1e9 / iters / argc;
+  printf("copt,%s,%s,%s,%s,%d,%.2f,%.2f\n", LANG, layout_names[layout],
+         mode_names[mode], loop_names[loop], argc, ns, 1e3 / ns);
+  fflush(stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const int modes[][2] = { /* {layout, mode} */
+    {OPTSFIRST, 0}, {OPTSFIRST, 1}, {MIXED, 1}, {MIXED, 2}, {MIXED, 3},
+    {MIXED, 4}
+  };
+  char **src, **work, **scratch;
+  long max_args = 10000000;
+  int header = 1, n;
+  size_t i;
+  struct copt opt = copt_init(argc, argv, 1);
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "m|max-args")) {
+      max_args = strtol(copt_arg(&opt), NULL, 10);
+    } else if (copt_opt(&opt, "no-header")) {
+      header = 0;
+    } else {
+      fprintf(stderr, "usage: %s [--max-args=N] [--no-header]\n",
+              COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
+
+  src = (char **) malloc(max_args * sizeof *src);
+  work = (char **) malloc(max_args * sizeof *work);
+  scratch = (char **) malloc(max_args * sizeof *scratch);
+  if (!src || !work || !scratch)
+    return fprintf(stderr, "out of memory\n"), 1;
+  if (copt_tab_bind(&bind_tab, binds, (int) (sizeof binds / sizeof *binds),
+                    bind_slots, 32) != 0)
+    return fprintf(stderr, "too few bind_slots\n"), 1;
+
+  if (header)
+    printf("bench,lang,layout,mode,loop,nargs,ns_per_arg,margs_per_s\n");
+  for (n = 10; n <= max_args; n *= 10) {
+    for (i = 0; i < sizeof modes / sizeof *modes; i++) {
+      enum layout layout = (enum layout) modes[i][0];
+      int mode = modes[i][1];
+      if (layout == MIXED && mode == 1 && n > 100000)
+        continue;
+      mkargs(src, n, layout, 0);
+      run(layout, LOOP_NEXT, mode, n, src, work, scratch);
+      run(layout, LOOP_OPT, mode, n, src, work, scratch);
+      mkargs(src, n, layout, 1);
+      run(layout, LOOP_ARG, mode, n, src, work, scratch);
+      run(layout, LOOP_BIND, mode, n, src, work, scratch);
+    }
+    if (n > max_args / 10)
+      break;
+  }
+  run_chains(max_args < 100000 ? (int) max_args : 100000, src, work);
+  run_complete(1000);
+  free(src);
+  free(work);
+  free(scratch);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/* copt-check.h - minimal check helpers shared by small copt test programs
+   https://github.com/fardaniqbal/copt/
+
+   Each test_check() counts one test and reports it right away if it
+   failed.  Include it from ONE source file per test binary. */
+#ifndef COPT_CHECK_H
+#define COPT_CHECK_H
+#include <stdarg.h>
+#include <stdio.h>
+
+static size_t total_test_cnt;
+static size_t failed_test_cnt;
+
+/* Count a test, and if COND is false, report FMT as a failure at FILE and
+   LINE.  Return COND. */
+static int
+test_check(const char *file, int line, int cond, const char *fmt, ...)
+{
+  va_list ap;
+  total_test_cnt++;
+  if (cond)
+    return 1;
+  fflush(stdout);
+  fprintf(stderr, "%s:%d: ", file, line);
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fprintf(stderr, ": FAIL\n");
+  failed_test_cnt++;
+  return 0;
+}
+
+/* Print a summary of all checks, and return main()'s exit status. */
+static int
+test_summary(void)
+{
+  if (failed_test_cnt == 0)
+    printf("Passed all %lu tests\n", (unsigned long) total_test_cnt);
+  else
+    fprintf(stderr, "FAILED %lu of %lu tests\n",
+            (unsigned long) failed_test_cnt, (unsigned long) total_test_cnt);
+  return !!failed_test_cnt;
+}
+
+#endif /* COPT_CHECK_H */
@@ -0,0 +1,347 @@
+/* copt-fuzz.c - differential fuzzer comparing copt with getopt_long()
+   https://github.com/fardaniqbal/copt/
+
+   Generates random argv arrays and parses each one with both copt and
+   glibc's getopt_long(), then checks that they give the same stream of
+   options, option args, and non-option args.  getopt_long() is reset with
+   optind = 0, so every case runs in-process rather than in a fork.
+
+   copt and getopt_long() differ on purpose in a few ways, so generated
+   argvs avoid them: "-s=ARG" (copt drops the '='), "--opt ARG" where ARG
+   looks like an option (copt won't take it), abbreviated long options, and
+   "--flag=ARG" for options without args.  The optspecs map like so:
+
+   copt optspec          getopt_long()
+   --------------------  -------------------------------
+   x, y, z, m            "xyzm" in optstring
+   longopt               {"longopt", no_argument}
+   m|multiple-opts       {"multiple-opts", no_argument}
+   s                     "s:" in optstring
+   long-with-arg         {"long-with-arg", required_argument}
+   a|multiple-with-arg   "a:", {"multiple-with-arg", required_argument}
+   o|optional-arg        "o::", {"optional-arg", optional_argument}
+
+   reorder=0 uses optstring prefix "+:" (stop at first non-option), and
+   reorder=1 uses ":" (permute).  Needs glibc. */
+#include "copt.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef __GLIBC__
+# error "copt-fuzz compares against glibc's getopt_long()"
+#endif
+
+enum { MAXARGS = 16, MAXEVENTS = 64 };
+enum evtype { EV_OPT = 1, EV_OPTARG, EV_NOOPTARG, EV_MISSING, EV_BADOPT,
+              EV_ARG };
+
+static const char *const specs[] = {
+  "x", "y", "z", "longopt", "m|multiple-opts", "s", "long-with-arg",
+  "a|multiple-with-arg", "o|optional-arg"
+};
+enum { NSPEC = (int) (sizeof specs / sizeof *specs) };
+
+static const struct option longopts[] = {
+  {"longopt",           no_argument,       NULL, 256 + 3},
+  {"multiple-opts",     no_argument,       NULL, 256 + 4},
+  {"long-with-arg",     required_argument, NULL, 256 + 6},
+  {"multiple-with-arg", required_argument, NULL, 256 + 7},
+  {"optional-arg",      optional_argument, NULL, 256 + 8},
+  {NULL, 0, NULL, 0}
+};
+
+struct event {
+  enum evtype type;
+  int id;               /* optspec index for EV_OPT */
+  const char *str;      /* arg for EV_OPTARG and EV_ARG */
+};
+
+struct trace {
+  int cnt;
+  struct event ev[MAXEVENTS];
+};
+
+static void
+add(struct trace *t, enum evtype type, int id, const char *str)
+{
+  if (t->cnt < MAXEVENTS) {
+    t->ev[t->cnt].type = type;
+    t->ev[t->cnt].id = id;
+    t->ev[t->cnt].str = str;
+  }
+  t->cnt++;
+}
+
+/* Small fast PRNG (xorshift32) so each worker is reproducible by seed. */
+static unsigned long rng;
+
+static unsigned
+rnd(unsigned n)
+{
+  rng ^= (rng << 13) & 0xffffffffUL;
+  rng ^= rng >> 17;
+  rng ^= (rng << 5) & 0xffffffffUL;
+  return (unsigned) (rng % n);
+}
+
+/* Random value for an attached or separate option arg.  Never starts with
+   '=' when attached to a short option, since copt skips that '='. */
+static const char *
+rnd_value(void)
+{
+  static const char *const vals[] = {
+    "v", "val", "-v", "--v", "-", "a=b", "x", "s", ""
+  };
+  return vals[rnd(sizeof vals / sizeof *vals)];
+}
+
+static const char *
+rnd_nonopt(void)
+{
+  static const char *const vals[] = {"file", "-", "", "a=b", "x", "=v"};
+  return vals[rnd(sizeof vals / sizeof *vals)];
+}
+
+/* Fill ARGV with a random command line in BUF.  Return argc. */
+static int
+gen_argv(char **argv, char *buf, size_t cap)
+{
+  static const char *const longs[] = {
+    "--longopt", "--multiple-opts", "--long-with-arg", "--multiple-with-arg",
+    "--optional-arg", "--bogus"
+  };
+  int argc = 1, want = (int) rnd(MAXARGS - 1), needarg = 0;
+  char *p = buf;
+  argv[0] = (char *) "copt-fuzz";
+  while (argc < want) {
+    unsigned kind = rnd(8);
+    char *tok = p;
+    if (needarg) {                  /* separate arg must not look like opt */
+      strcpy(p, rnd_nonopt());
+      needarg = 0;
+    } else if (kind < 3) {          /* short option group */
+      int i, n = 1 + (int) rnd(3);
+      *p++ = '-';
+      for (i = 0; i < n; i++)
+        *p++ = "xyzmq"[rnd(5)];
+      if (rnd(2)) {
+        const char *v = rnd(2) ? rnd_value() : "";
+        *p++ = "sao"[rnd(3)];
+        needarg = *v == '\0' && p[-1] != 'o';
+        strcpy(p, v);
+        p += strlen(v);
+      }
+      *p = '\0';
+    } else if (kind < 5) {          /* long option */
+      unsigned i = rnd(sizeof longs / sizeof *longs);
+      strcpy(p, longs[i]);
+      if ((i == 2 || i == 3 || i == 4 || i == 5) && rnd(2))
+        strcat(strcat(p, "="), rnd_value());
+      else
+        needarg = i == 2 || i == 3;
+    } else if (kind < 6) {
+      strcpy(p, rnd(4) ? "-" : "--");
+    } else {
+      strcpy(p, rnd_nonopt());
+    }
+    p += strlen(p) + 1;
+    argv[argc++] = tok;
+    if ((size_t) (p - buf) + 64 > cap)
+      break;
+  }
+  argv[argc] = NULL;
+  return argc;
+}
+
+static char *
+missing(const struct copt *opt, void *aux)
+{
+  add((struct trace *) aux, EV_MISSING, 0, NULL);
+  (void) opt;
+  return NULL;
+}
+
+static void
+run_copt(int argc, char **argv, int reorder, struct trace *t)
+{
+  struct copt opt = copt_init(argc, argv, reorder);
+  const char *arg;
+  int i, id;
+  copt_set_noargfn(&opt, missing, t);
+  while (copt_next(&opt)) {
+    for (id = 0; id < NSPEC && !copt_opt(&opt, specs[id]); id++)
+      continue;
+    if (id == NSPEC) {
+      add(t, EV_BADOPT, 0, NULL);
+      continue;
+    }
+    add(t, EV_OPT, id, NULL);
+    if (id == 5 || id == 6 || id == 7) {
+      if ((arg = copt_arg(&opt)) != NULL)
+        add(t, EV_OPTARG, 0, arg);
+    } else if (id == 8) {
+      arg = copt_oarg(&opt);
+      add(t, arg ? EV_OPTARG : EV_NOOPTARG, 0, arg);
+    }
+  }
+  for (i = copt_idx(&opt); i < argc; i++)
+    add(t, EV_ARG, 0, argv[i]);
+}
+
+static void
+run_getopt(int argc, char **argv, int reorder, struct trace *t)
+{
+  const char *shortids = "xyz";
+  int c, i, id;
+  optind = 0;                       /* full reset, glibc extension */
+  opterr = 0;
+  while ((c = getopt_long(argc, argv, reorder ? ":xyzms:a:o::" :
+                          "+:xyzms:a:o::", longopts, NULL)) != -1) {
+    if (c == '?') {
+      add(t, EV_BADOPT, 0, NULL);
+      continue;
+    }
+    if (c == ':') {                 /* copt reports opt, then missing arg */
+      id = optopt >= 256 ? optopt - 256 : optopt == 's' ? 5 : 7;
+      add(t, EV_OPT, id, NULL);
+      add(t, EV_MISSING, 0, NULL);
+      continue;
+    }
+    if (c >= 256)
+      id = c - 256;
+    else if (strchr(shortids, c))
+      id = (int) (strchr(shortids, c) - shortids);
+    else
+      id = c == 'm' ? 4 : c == 's' ? 5 : c == 'a' ? 7 : 8;
+    add(t, EV_OPT, id, NULL);
+    if (id == 5 || id == 6 || id == 7)
+      add(t, EV_OPTARG, 0, optarg);
+    else if (id == 8)
+      add(t, optarg ? EV_OPTARG : EV_NOOPTARG, 0, optarg);
+  }
+  for (i = optind; i < argc; i++)
+    add(t, EV_ARG, 0, argv[i]);
+}
+
+static int
+ev_eq(const struct event *a, const struct event *b)
+{
+  return a->type == b->type && a->id == b->id &&
+         (a->str == NULL) == (b->str == NULL) &&
+         (a->str == NULL || !strcmp(a->str, b->str));
+}
+
+static void
+print_trace(const char *name, const struct trace *t)
+{
+  static const char *const types[] = {
+    "", "OPT", "OPTARG", "NOOPTARG", "MISSING", "BADOPT", "ARG"
+  };
+  int i;
+  fprintf(stderr, "  %s:", name);
+  for (i = 0; i < t->cnt && i < MAXEVENTS; i++) {
+    fprintf(stderr, " %s", types[t->ev[i].type]);
+    if (t->ev[i].type == EV_OPT)
+      fprintf(stderr, "(%s)", specs[t->ev[i].id]);
+    else if (t->ev[i].str)
+      fprintf(stderr, "('%s')", t->ev[i].str);
+  }
+  fprintf(stderr, "\n");
+}
+
+/* Run ITERS cases starting from SEED.  Return number of mismatches. */
+static long
+fuzz(unsigned long seed, long iters)
+{
+  static char buf[1024];
+  char *argv[MAXARGS+1], *cargv[MAXARGS+1], *gargv[MAXARGS+1];
+  struct trace ct, gt;
+  long n, bad = 0;
+  int argc, i, reorder;
+  rng = seed ? seed : 1;
+  for (n = 0; n < iters; n++) {
+    argc = gen_argv(argv, buf, sizeof buf);
+    reorder = (int) rnd(2);
+    memcpy(cargv, argv, (argc+1) * sizeof *argv);
+    memcpy(gargv, argv, (argc+1) * sizeof *argv);
+    ct.cnt = gt.cnt = 0;
+    run_copt(argc, cargv, reorder, &ct);
+    run_getopt(argc, gargv, reorder, &gt);
+    for (i = 0; i < ct.cnt && i < MAXEVENTS; i++)
+      if (!ev_eq(&ct.ev[i], &gt.ev[i]))
+        break;
+    if (ct.cnt == gt.cnt && i == ct.cnt)
+      continue;
+    if (bad++ < 10) {
+      fprintf(stderr, "MISMATCH (seed %lu, case %ld, reorder=%d):",
+              seed, n, reorder);
+      for (i = 1; i < argc; i++)
+        fprintf(stderr, " '%s'", argv[i]);
+      fprintf(stderr, "\n");
+      print_trace("copt  ", &ct);
+      print_trace("getopt", &gt);
+    }
+  }
+  return bad;
+}
+
+static double
+now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct copt opt = copt_init(argc, argv, 1);
+  long iters = 1000000, jobs = 1, seed = 1, bad = 0, i;
+  double start = now(), secs;
+  int status;
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "n|iterations")) {
+      iters = strtol(copt_arg(&opt), NULL, 10);
+    } else if (copt_opt(&opt, "j|jobs")) {
+      jobs = strtol(copt_arg(&opt), NULL, 10);
+    } else if (copt_opt(&opt, "s|seed")) {
+      seed = strtol(copt_arg(&opt), NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-n ITERATIONS] [-j JOBS] [-s SEED]\n"
+              "  -j 0 runs one worker per core\n", COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
+  if (jobs <= 0)
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  jobs = jobs > 0 ? jobs : 1;
+
+  /* One worker process per job, each fuzzing ITERS cases in a loop. */
+  fflush(stdout);
+  for (i = 0; i < jobs; i++) {
+    pid_t pid = jobs == 1 ? 0 : fork();
+    if (pid < 0)
+      perror("fork"), exit(1);
+    if (pid == 0) {
+      bad = fuzz((unsigned long) (seed + i * 7919), iters);
+      if (jobs == 1)
+        break;
+      _exit(bad != 0);
+    }
+  }
+  if (jobs > 1)
+    while (wait(&status) > 0)
+      bad += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+
+  secs = now() - start;
+  printf("%ld execs in %.2f s (%.0f/s, %ld worker%s): %s\n", iters * jobs,
+         secs, iters * jobs / secs, jobs, jobs == 1 ? "" : "s",
+         bad ? "MISMATCHES FOUND" : "no mismatches");
+  return bad != 0;
+}
@@ -0,0 +1,72 @@
+/* copt-gen-test.c - tests for matchers generated by copt-gen.c
+   https://github.com/fardaniqbal/copt/
+
+   copt-gen-test.inc is generated from copt-gen-test.txt by the Makefile. */
+#include "copt-gen-test.inc"
+#include "copt-check.h"
+
+/* Check gen_id() against a copt_opt() chain for each option in ARGS. */
+static void
+test_ids(int line, int reorder, const char *const *args)
+{
+  char *argv[32];
+  int argc = 0, id;
+  struct copt opt;
+  argv[argc++] = (char *) "copt";
+  while (*args)
+    argv[argc++] = (char *) *args++;
+  opt = copt_init(argc, argv, reorder);
+  while (copt_next(&opt)) {
+    for (id = 0; id < GEN_NSPEC && !copt_opt(&opt, gen_specs[id]); id++)
+      continue;
+    id = id < GEN_NSPEC ? id : -1;
+    test_check(__FILE__, line, gen_id(&opt) == id,
+               "gen_id(%s) returned %d, expected %d", copt_curopt(&opt),
+               gen_id(&opt), id);
+  }
+}
+
+int
+main(void)
+{
+  static const char *const args[][8] = {
+    {"-x", "-y", "-q", NULL},
+    {"-xyzsa", "-m", "--multiple-opts", NULL},
+    {"--longopt", "--longopt=", "--longopts", "--long", NULL},
+    {"--dup", "--x", "--a=b", "--multiple-with-arg=x", NULL},
+    {"--=x", "-=", "-x=", "--optional-arg", "--o", NULL},
+    {"nonopt", "--s", "-o", "--", "-x", NULL},
+    {"--lengthy", "--longer1", "--longer2", "--longer3", "--lower", NULL},
+    {"--lengthz", "--lo", "-l", "--quote\"'", "--quote", "--quote\"", NULL}
+  };
+  static const int enums[] = { /* must match optspec order */
+    GEN_X, GEN_Y, GEN_LONGOPT, GEN_MULTIPLE_OPTS, GEN_S, GEN_LONG_WITH_ARG,
+    GEN_MULTIPLE_WITH_ARG, GEN_DUP, GEN_OPTIONAL_ARG, GEN_, GEN__,
+    GEN_LENGTHY, GEN_LONGER1, GEN_LONGER2, GEN_LOWER, GEN_QUOTE__
+  };
+  struct copt_slot names[64];
+  size_t i;
+  int reorder, n;
+  for (reorder = 0; reorder < 2; reorder++)
+    for (i = 0; i < sizeof args / sizeof *args; i++)
+      test_ids(__LINE__, reorder, args[i]);
+  for (i = 0; i < sizeof enums / sizeof *enums; i++)
+    test_check(__FILE__, __LINE__, enums[i] == (int) i,
+               "enum for '%s' is %d, expected %d", gen_specs[i], enums[i],
+               (int) i);
+  n = copt_names_init(gen_specs, GEN_NSPEC, names, 64);
+  for (i = 0; n == GEN_NNAME && i < GEN_NNAME; i++)
+    if (names[i].len != gen_names[i].len || names[i].id != gen_names[i].id ||
+        memcmp(names[i].name, gen_names[i].name, names[i].len))
+      n = -1;
+  test_check(__FILE__, __LINE__, n == GEN_NNAME &&
+             gen_kinds[GEN_LONG_WITH_ARG] == COPT_ARG_REQUIRED &&
+             gen_kinds[GEN_MULTIPLE_WITH_ARG] == COPT_ARG_REQUIRED &&
+             gen_kinds[GEN_OPTIONAL_ARG] == COPT_ARG_OPTIONAL &&
+             gen_kinds[GEN_LONGOPT] == COPT_ARG_NONE,
+             "gen_names or gen_kinds is wrong");
+  test_check(__FILE__, __LINE__, GEN_NSPEC == sizeof enums / sizeof *enums,
+             "GEN_NSPEC is %d, expected %d", GEN_NSPEC,
+             (int) (sizeof enums / sizeof *enums));
+  return test_summary();
+}
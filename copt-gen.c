@@ -0,0 +1,310 @@
+/* copt-gen.c - generate a specialized option matcher from optspecs
+   https://github.com/fardaniqbal/copt/
+
+   Reads optspecs like "o|outfile", one per line, and writes C89 source to
+   #include in the one file with your copt_next() loop.  An optspec can be
+   followed by blanks and "arg" or "oarg" if you call copt_arg() or
+   copt_oarg() for it.  Blank lines and lines starting with '#' are
+   skipped.  With prefix P, it defines:
+
+   enum { P_OUTFILE, ... }     - optspec ids, named after each optspec's
+                                 first long name, or its only name
+   P_specs[], P_NSPEC          - the optspecs, e.g. for copt_suggest()
+   int P_find(s, len)          - id of optspec with LEN-byte name S, or -1
+   int P_id(opt)               - P_find() on copt_next()'s current option
+   P_kinds[], P_names[],       - with -c, each optspec's COPT_ARG_* kind
+   P_NNAME                       and copt_names_init()'s sorted names, for
+                                 copt_complete() to use with no setup
+
+   P_find() switches on the name's length, then its first byte, then
+   memcmp()s the rest against each candidate, like gperf.  As with
+   copt_id(), earlier optspecs win if they share a name, and P_id() gives
+   the same result as calling copt_opt() on each optspec in order.
+   Generated code uses no heap and nothing beyond copt.h and string.h.
+
+   Example usage:
+
+   copt-gen -p opts -o opts.inc opts.txt
+
+   #include "opts.inc"
+   ...
+   while (copt_next(&opt)) {
+     switch (opts_id(&opt)) {
+       case OPTS_OUTFILE: out = copt_arg(&opt); break;
+       ...
+     }
+   } */
+#include "copt.h"
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { MAXSPEC = 4096, MAXLINE = 256, MAXNAME = 16*MAXSPEC };
+
+struct name {
+  const char *str;      /* not nul-terminated */
+  int len;
+  int id;               /* index of optspec containing name */
+};
+
+static char specs[MAXSPEC][MAXLINE];
+static const char *specptrs[MAXSPEC];
+static unsigned char kinds[MAXSPEC];
+static int nspec;
+static struct name names[MAXNAME];
+static int nname;
+static char enums[MAXSPEC][MAXLINE+16];
+static struct copt_slot sorted[MAXNAME]; /* from copt_names_init() */
+
+/* Order names by length, then first byte, then the rest, then id. */
+static int
+cmp_name(const void *a, const void *b)
+{
+  const struct name *x = (const struct name *) a;
+  const struct name *y = (const struct name *) b;
+  int c;
+  if (x->len != y->len)
+    return x->len < y->len ? -1 : 1;
+  if ((c = memcmp(x->str, y->str, x->len)) != 0)
+    return c;
+  return x->id < y->id ? -1 : x->id > y->id;
+}
+
+/* Read optspecs from FP into specs.  Return 0 on success. */
+static int
+read_specs(FILE *fp, const char *path)
+{
+  char *s, *kind;
+  int line = 0;
+  size_t len;
+  while (fgets(specs[nspec], MAXLINE, fp) != NULL) {
+    line++;
+    s = specs[nspec];
+    len = strlen(s);
+    if (len == MAXLINE-1 && s[len-1] != '\n')
+      return fprintf(stderr, "%s:%d: line too long\n", path, line), -1;
+    while (len > 0 && isspace((unsigned char) s[len-1]))
+      s[--len] = '\0';
+    if (len == 0 || s[0] == '#')
+      continue;
+    if (*(kind = s + strcspn(s, " \t")) != '\0') {
+      *kind++ = '\0';
+      kind += strspn(kind, " \t");
+      if (strcmp(kind, "arg") && strcmp(kind, "oarg"))
+        return fprintf(stderr, "%s:%d: expected arg or oarg after optspec\n",
+                       path, line), -1;
+      kinds[nspec] = kind[0] == 'a' ? COPT_ARG_REQUIRED : COPT_ARG_OPTIONAL;
+    }
+    specptrs[nspec] = specs[nspec];
+    if (++nspec == MAXSPEC)
+      return fprintf(stderr, "%s: too many optspecs\n", path), -1;
+  }
+  return ferror(fp) ? (perror(path), -1) : 0;
+}
+
+/* Split optspecs into names, sort them, and drop later duplicates.
+   Return 0 on success, or -1 if there are too many names. */
+static int
+split_names(void)
+{
+  const char *start, *end;
+  int i, j;
+  for (i = 0; i < nspec; i++) {
+    for (start = specs[i]; *start != '\0'; start = end + (*end != '\0')) {
+      end = strchr(start, '|');
+      end = end ? end : start + strlen(start);
+      if (nname == MAXNAME)
+        return fprintf(stderr, "too many option names\n"), -1;
+      names[nname].str = start;
+      names[nname].len = (int) (end - start);
+      names[nname++].id = i;
+    }
+  }
+  qsort(names, nname, sizeof *names, cmp_name);
+  for (i = j = 0; i < nname; i++)
+    if (j == 0 || names[i].len != names[j-1].len ||
+        memcmp(names[i].str, names[j-1].str, names[i].len))
+      names[j++] = names[i];
+  nname = j;
+  return 0;
+}
+
+/* Name enum constants PREFIX_NAME after each optspec's first long name.
+   Return 0 on success, or -1 if two optspecs would get the same name. */
+static int
+name_enums(const char *prefix)
+{
+  const char *start, *end, *name;
+  char *out;
+  int i, j, len;
+  for (i = 0; i < nspec; i++) {
+    name = specs[i], len = (int) strcspn(specs[i], "|");
+    for (start = specs[i]; *start != '\0'; start = end + (*end != '\0')) {
+      end = start + strcspn(start, "|");
+      if (end - start > 1) {
+        name = start, len = (int) (end - start);
+        break;
+      }
+    }
+    out = enums[i];
+    for (j = 0; prefix[j] != '\0'; j++)
+      *out++ = (char) toupper((unsigned char) prefix[j]);
+    *out++ = '_';
+    for (j = 0; j < len; j++)
+      *out++ = isalnum((unsigned char) name[j]) ?
+               (char) toupper((unsigned char) name[j]) : '_';
+    *out = '\0';
+    for (j = 0; j < i; j++)
+      if (!strcmp(enums[i], enums[j]))
+        return fprintf(stderr, "optspecs '%s' and '%s' both map to %s\n",
+                       specs[j], specs[i], enums[i]), -1;
+  }
+  return 0;
+}
+
+/* Write LEN bytes at S to FP as the inside of a C string or char literal
+   with QUOTE as its delimiter. */
+static void
+put_quoted(FILE *fp, const char *s, int len, int quote)
+{
+  int i, c;
+  for (i = 0; i < len; i++) {
+    c = (unsigned char) s[i];
+    if (c == quote || c == '\\')
+      fprintf(fp, "\\%c", c);
+    else if (c < ' ' || c > '~')
+      fprintf(fp, "\\%03o", c);
+    else
+      putc(c, fp);
+  }
+}
+
+static void
+gen(FILE *fp, const char *prefix, const char *path)
+{
+  int i, j, k;
+  fprintf(fp, "/* Generated by copt-gen from %s.  Do not edit. */\n", path);
+  fprintf(fp, "#include \"copt.h\"\n#include <string.h>\n\n");
+
+  fprintf(fp, "enum {\n");
+  for (i = 0; i < nspec; i++)
+    fprintf(fp, "  %s%s\n", enums[i], i+1 < nspec ? "," : "");
+  fprintf(fp, "};\n\n");
+
+  fprintf(fp, "#define %.*sNSPEC %d\n\n", (int) strlen(prefix) + 1,
+          enums[0], nspec);    /* enums[0] starts with uppercase PREFIX_ */
+  fprintf(fp, "static const char *const %s_specs[] = {\n", prefix);
+  for (i = 0; i < nspec; i++) {
+    fprintf(fp, "  \"");
+    put_quoted(fp, specs[i], (int) strlen(specs[i]), '"');
+    fprintf(fp, "\"%s\n", i+1 < nspec ? "," : "");
+  }
+  fprintf(fp, "};\n\n");
+
+  fprintf(fp, "/* Return id of optspec with LEN-byte name S, or -1. */\n");
+  fprintf(fp, "static int\n%s_find(const char *s, int len)\n{\n", prefix);
+  fprintf(fp, "  switch (len) {\n");
+  for (i = 0; i < nname; i = j) {
+    for (j = i; j < nname && names[j].len == names[i].len; j++)
+      continue;
+    if (names[i].len == 0) {
+      fprintf(fp, "    case 0:\n      return %s;\n", enums[names[i].id]);
+      continue;
+    }
+    fprintf(fp, "    case %d:\n      switch (s[0]) {\n", names[i].len);
+    for (k = i; k < j; k++) {
+      if (k == i || names[k].str[0] != names[k-1].str[0]) {
+        fprintf(fp, "        case '");
+        put_quoted(fp, names[k].str, 1, '\'');
+        fprintf(fp, "':\n");
+      }
+      if (names[k].len == 1) {
+        fprintf(fp, "          return %s;\n", enums[names[k].id]);
+        continue;
+      }
+      fprintf(fp, "          if (!memcmp(s+1, \"");
+      put_quoted(fp, names[k].str + 1, names[k].len - 1, '"');
+      fprintf(fp, "\", %d))\n            return %s;\n", names[k].len - 1,
+              enums[names[k].id]);
+      if (k+1 == j || names[k+1].str[0] != names[k].str[0])
+        fprintf(fp, "          break;\n");
+    }
+    fprintf(fp, "      }\n      break;\n");
+  }
+  fprintf(fp, "  }\n  return -1;\n}\n\n");
+
+  fprintf(fp, "/* After copt_next() indicates more options remain, return "
+              "the id of the\n   first optspec matching the current "
+              "option, or -1 if none match. */\n");
+  fprintf(fp, "static int\n%s_id(const struct copt *opt)\n{\n", prefix);
+  fprintf(fp, "  return %s_find(opt->name, opt->namelen);\n}\n", prefix);
+}
+
+/* Write tables for copt_complete(). */
+static void
+gen_complete(FILE *fp, const char *prefix)
+{
+  int i, n = copt_names_init(specptrs, nspec, sorted, MAXNAME);
+  assert(n >= 0);               /* split_names() checked count */
+  fprintf(fp, "\n/* COPT_ARG_* kind of each optspec. */\n");
+  fprintf(fp, "static const unsigned char %s_kinds[] = {", prefix);
+  for (i = 0; i < nspec; i++)
+    fprintf(fp, "%s%d%s", i % 16 ? " " : "\n  ", kinds[i],
+            i+1 < nspec ? "," : "");
+  fprintf(fp, "\n};\n\n");
+  fprintf(fp, "#define %.*sNNAME %d\n\n", (int) strlen(prefix) + 1,
+          enums[0], n);
+  fprintf(fp, "/* Names sorted as by copt_names_init(). */\n");
+  fprintf(fp, "static const struct copt_slot %s_names[] = {\n", prefix);
+  for (i = 0; i < n; i++) {
+    fprintf(fp, "  {\"");
+    put_quoted(fp, sorted[i].name, sorted[i].len, '"');
+    fprintf(fp, "\", %d, %s}%s\n", sorted[i].len, enums[sorted[i].id],
+            i+1 < n ? "," : "");
+  }
+  fprintf(fp, "};\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  const char *prefix = "opts", *out = NULL, *in = "-";
+  int complete = 0;
+  FILE *fp;
+  struct copt opt = copt_init(argc, argv, 1);
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "p|prefix")) {
+      prefix = copt_arg(&opt);
+    } else if (copt_opt(&opt, "o|output")) {
+      out = copt_arg(&opt);
+    } else if (copt_opt(&opt, "c|complete")) {
+      complete = 1;
+    } else {
+      fprintf(stderr, "usage: %s [-c] [-p PREFIX] [-o OUTPUT] [SPECFILE]\n",
+              COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
+  if (copt_idx(&opt) < argc)
+    in = argv[copt_idx(&opt)];
+  if ((fp = strcmp(in, "-") ? fopen(in, "r") : stdin) == NULL)
+    return perror(in), 1;
+  if (read_specs(fp, in) != 0)
+    return 1;
+  if (fp != stdin)
+    fclose(fp);
+  if (nspec == 0)
+    return fprintf(stderr, "%s: no optspecs\n", in), 1;
+  if (split_names() != 0 || name_enums(prefix) != 0)
+    return 1;
+  if ((fp = out ? fopen(out, "w") : stdout) == NULL)
+    return perror(out), 1;
+  gen(fp, prefix, strcmp(in, "-") ? in : "stdin");
+  if (complete)
+    gen_complete(fp, prefix);
+  if (fflush(fp) != 0 || ferror(fp) || (fp != stdout && fclose(fp) != 0))
+    return perror(out ? out : "stdout"), 1;
+  return 0;
+}
@@ -0,0 +1,117 @@
+/* copt-hpp-bench.cpp - compare copt.hpp matching with copt_opt() chains
+   https://github.com/fardaniqbal/copt/
+
+   Prints CSV rows in the same format as copt-bench.c, where loop is the
+   matching method. */
+#define COPT_IMPL
+#include "copt.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define SPECS \
+  "a|all", "b|brief", "c|color", "d|debug", "e|echo", "f|force",       \
+  "g|group", "h|help", "i|input", "j|jobs", "k|keep", "l|list",         \
+  "m|mode", "n|dry-run", "o|output", "p|parents", "q|quiet", "r|recurse",\
+  "s|size", "t|target", "u|update", "v|verbose", "w|width", "x|exclude",\
+  "y|yes", "z|zero", "A|archive", "B|backup", "C|directory",            \
+  "D|define", "E|preprocess", "F|format", "G|global", "H|headers",      \
+  "I|include", "J|json", "K|kill", "L|link", "M|make-deps", "N|numeric",\
+  "O|optimize", "P|pipe", "Q|query", "R|reverse", "S|suffix",           \
+  "T|tags", "U|undef", "V|version", "W|warn", "X|extract"
+
+static constexpr auto opts = coptpp::compile(SPECS);
+static const char *const specs[] = {SPECS};
+static const int nspec = (int) (sizeof specs / sizeof *specs);
+
+enum { NARG = 1000000, ROUNDS = 5 };
+static char *args[NARG+1];
+static char argbuf[NARG][16];
+
+/* Fill argv with options picked from specs, half short and half long. */
+static void
+mkargs(void)
+{
+  int i;
+  args[0] = (char *) "bench";
+  srand(1);
+  for (i = 0; i < NARG; i++) {
+    const char *spec = specs[rand() % nspec];
+    if (i % 2)
+      snprintf(argbuf[i], sizeof argbuf[i], "-%c", spec[0]);
+    else
+      snprintf(argbuf[i], sizeof argbuf[i], "--%s", spec+2);
+    args[i+1] = argbuf[i];
+  }
+}
+
+static volatile long sink; /* keep results from being optimized */
+
+static long
+match_chain(struct copt *opt)
+{
+  int id;
+  for (id = 0; id < nspec && !copt_opt(opt, specs[id]); id++)
+    continue;
+  return id;
+}
+
+static long
+match_tab(struct copt *opt)
+{
+  static struct copt_slot slots[2*nspec];
+  static struct copt_tab tab;
+  if (tab.slots == NULL)
+    copt_tab_init(&tab, specs, nspec, slots, 2*nspec);
+  return copt_id(opt, &tab);
+}
+
+static long
+match_hpp(struct copt *opt)
+{
+  return opts.id(opt);
+}
+
+/* Print average ns per argument for matching all args with MATCH. */
+static void
+run(const char *name, long (*match)(struct copt *))
+{
+  double best = 0;
+  int round;
+  for (round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    struct copt opt = copt_init(NARG+1, args, 0);
+    long sum = 0;
+    while (copt_next(&opt))
+      sum += match(&opt);
+    sink += sum;
+    std::chrono::duration<double, std::nano> ns =
+      std::chrono::steady_clock::now() - start;
+    if (round == 0 || ns.count() < best)
+      best = ns.count();
+  }
+  printf("copt-hpp,c++,optsfirst,reorder=0,%s,%d,%.2f,%.2f\n", name, NARG,
+         best / NARG, 1e3 * NARG / best);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct copt opt = copt_init(argc, argv, 1);
+  int header = 1;
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "no-header")) {
+      header = 0;
+    } else {
+      fprintf(stderr, "usage: %s [--no-header]\n", COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
+  mkargs();
+  if (header)
+    printf("bench,lang,layout,mode,loop,nargs,ns_per_arg,margs_per_s\n");
+  run("copt_opt-chain", match_chain);
+  run("copt_id", match_tab);
+  run("copt.hpp", match_hpp);
+  return 0;
+}
@@ -0,0 +1,69 @@
+/* copt-hpp-test.cpp - tests for copt.hpp
+   https://github.com/fardaniqbal/copt/ */
+#include "copt.hpp"
+#include "copt-check.h"
+
+#undef NDEBUG
+#include <cassert>
+
+#define SPECS "x", "y", "longopt", "m|multiple-opts", "s", "long-with-arg", \
+              "a|multiple-with-arg", "x|dup", "o|optional-arg", "|=", "="
+
+static constexpr auto opts = coptpp::compile(SPECS);
+static const char *const specs[] = {SPECS};
+static const int nspec = (int) (sizeof specs / sizeof *specs);
+
+/* These must be compile-time constants to work as case labels. */
+static_assert(opts["x"] == 0, "first optspec");
+static_assert(opts["o|optional-arg"] == 8, "later optspec");
+static_assert(opts.find("multiple-opts", 13) == 3, "long name");
+static_assert(opts.find("dup", 3) == 7, "long name after duplicate");
+static_assert(opts.find("multiple", 8) == -1, "prefix isn't a match");
+static_assert(opts.find("a", 1) == 6, "short name");
+static_assert(opts.find("", 0) == 9, "empty name");
+
+/* Check opts.id() against a copt_opt() chain for each option in ARGV. */
+static void
+test_ids(int line, int reorder, const char *const *args)
+{
+  char *argv[32];
+  int argc = 0, id;
+  struct copt opt;
+  argv[argc++] = (char *) "copt";
+  while (*args)
+    argv[argc++] = (char *) *args++;
+  opt = copt_init(argc, argv, reorder);
+  while (copt_next(&opt)) {
+    for (id = 0; id < nspec && !copt_opt(&opt, specs[id]); id++)
+      continue;
+    id = id < nspec ? id : -1;
+    test_check(__FILE__, line, opts.id(&opt) == id,
+               "opts.id(%s) returned %d, expected %d",
+               copt_curopt(&opt), opts.id(&opt), id);
+  }
+}
+
+#define TEST_IDS(reorder, ...) do {                             \
+    static const char *const args_[] = {__VA_ARGS__, nullptr};  \
+    test_ids(__LINE__, (reorder), args_);                       \
+  } while (0)
+
+int
+main()
+{
+  int reorder;
+  for (reorder = 0; reorder < 2; reorder++) {
+    TEST_IDS(reorder, "-x", "-y", "-q");
+    TEST_IDS(reorder, "-xyzsa", "-m", "--multiple-opts");
+    TEST_IDS(reorder, "--longopt", "--longopt=", "--longopts", "--long");
+    TEST_IDS(reorder, "--dup", "--x", "--a=b", "--multiple-with-arg=x");
+    TEST_IDS(reorder, "--=x", "-=", "-x=", "--optional-arg", "--o");
+    TEST_IDS(reorder, "nonopt", "--s", "-o", "--", "-x");
+  }
+  switch (0) { /* case labels must compile */
+    case opts["x"]: break;
+    case opts["y"]: assert(0); break;
+    case opts["long-with-arg"]: assert(0); break;
+  }
+  return test_summary();
+}
@@ -5,10 +5,19 @@
 #  undef _CRT_SECURE_NO_WARNINGS
 #  define _CRT_SECURE_NO_WARNINGS 1 /* proprietary MS stuff */
 #endif
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef COPT_HAVE_MMAP
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__unix) || \
+    (defined(__APPLE__) && defined(__MACH__))
+#  define TEST_HAVE_SETENV 1 /* run_env_tests() needs POSIX setenv() */
+#endif
 
 #undef NDEBUG
 #include <assert.h>
@@ -24,57 +33,91 @@ static size_t total_test_cnt;
 static size_t failed_test_cnt;
 static int test_line;
 static char **fail_info; /* array of failed_test_cnt strings */
+static size_t fail_info_cap;  /* allocated items in fail_info */
+static size_t flog_len, flog_cap; /* of fail_info[failed_test_cnt] */
+static int test_verbose;  /* true to print every test, not just failures */
 
-/* Make sure fail_info array has space for failed_test_cnt+1 items. */
+/* Make sure fail_info array has space for failed_test_cnt+1 items, growing
+   it geometrically.  Return current fail_info string, which is NULL if
+   nothing has been logged for the current failure yet. */
 static char *
 flog_ensure_cap(void)
 {
   char **info = fail_info;
-  static size_t last_cnt;
-  size_t i, cnt = failed_test_cnt + 1;
-  if (!info)
-    info = (char **) calloc(cnt, sizeof *fail_info);
-  else
-    info = (char **) realloc(info, cnt * sizeof *fail_info);
-  if (!info)
+  size_t i, cap = fail_info_cap;
+  if (failed_test_cnt < cap)
+    return fail_info[failed_test_cnt];
+  while (cap <= failed_test_cnt)
+    cap = cap * 2 + 16;
+  if (!(info = (char **) realloc(info, cap * sizeof *fail_info)))
     fprintf(stderr, "flog_ensure_cap(): out of memory\n"), exit(1);
-  for (i = last_cnt; i < cnt; i++)
+  for (i = fail_info_cap; i < cap; i++)
     info[i] = NULL;
   fail_info = info;
-  last_cnt = cnt;
+  fail_info_cap = cap;
   return fail_info[failed_test_cnt];
 }
 
-/* Print message to current fail_info string, reallocating if necessary. */
+/* Append message to current fail_info string, reallocating if necessary.
+   The string's length is kept in flog_len, so appending doesn't rescan
+   what's already logged. */
 # ifdef __GNUC__
 __extension__ __attribute__((format(printf, 1, 2)))
 # endif
 static void
 flog(const char *fmt, ...)
 {
-  /* Using strlen on every call isn't the most efficient implementation in
-     terms of big-O, but should suffice for testing purposes. */
-  char *cp, *buf = flog_ensure_cap();
-  int rc, basecap, cap = 1;
+  char *buf = flog_ensure_cap();
+  size_t cap;
+  int rc;
   va_list ap;
-  if (buf == NULL && (buf = (char *) calloc(1,1)) == NULL)
-    fprintf(stderr, "flog(): out of memory\n"), exit(1);
-  basecap = strlen(buf);
-  cp = buf + basecap;
+  if (buf == NULL)
+    flog_len = flog_cap = 0;
 
   /* Do this in a loop because MSVC's vsnprintf returns < 0 on trunc. */
-  va_start(ap, fmt);
-  while ((rc = vsnprintf(cp, cap, fmt, ap)) >= cap || rc < 0) {
-    va_end(ap);
+  for (;;) {
+    if (buf != NULL) {
+      va_start(ap, fmt);
+      rc = vsnprintf(buf + flog_len, flog_cap - flog_len, fmt, ap);
+      va_end(ap);
+      if (rc >= 0 && (size_t) rc < flog_cap - flog_len)
+        break;
+    } else {
+      rc = -1;
+    }
     /* Just ignore int overflow. */
-    cap = rc >= 0 ? rc+1 : (basecap+cap) * 2 - basecap;
-    if ((buf = (char *) realloc(buf, basecap + cap)) == NULL)
+    cap = rc >= 0 ? flog_len + rc + 1 : flog_cap * 2 + 64;
+    cap = cap > flog_cap * 2 ? cap : flog_cap * 2;
+    if ((buf = (char *) realloc(buf, cap)) == NULL)
       fprintf(stderr, "not enough memory for fmt '%s'\n", fmt), exit(1);
-    cp = buf + basecap;
-    va_start(ap, fmt);
+    flog_cap = cap;
+    fail_info[failed_test_cnt] = buf;
   }
+  flog_len += rc;
+}
+
+/* Count a test at LINE, and if COND is false, log it as failed with a
+   message formatted from FMT.  Return COND. */
+# ifdef __GNUC__
+__extension__ __attribute__((format(printf, 3, 4)))
+# endif
+static int
+test_check(int line, int cond, const char *fmt, ...)
+{
+  char msg[256];
+  va_list ap;
+  total_test_cnt++;
+  if (cond)
+    return 1;
+  va_start(ap, fmt);
+  vsnprintf(msg, sizeof msg, fmt, ap);
   va_end(ap);
-  fail_info[failed_test_cnt] = buf;
+  msg[sizeof msg - 1] = '\0';  /* MSVC doesn't terminate on truncation */
+  fflush(stdout);
+  fprintf(stderr, "%s: FAIL\n", msg);
+  flog("%s:%d: %s\n", __FILE__, line, msg);
+  failed_test_cnt++;
+  return 0;
 }
 
 /* Return a malloc-d array of the given string varargs. */
@@ -151,6 +194,8 @@ struct testcase {
   size_t argc;
   char *argv[64];
   char *argv_copy[64]; /* because argv might get reordered */
+  size_t arena_used;
+  char arena[4096];    /* strings above point here, reset per test */
 };
 
 /* Print formatted table of expected vs actual args to failure log. */
@@ -177,15 +222,18 @@ testcase_dump(const struct testcase *tc)
   }
 }
 
+/* Copy STR into TC's arena, so nothing needs freeing after the test. */
 static char *
-my_strdup(const char *str)
+test_strdup(struct testcase *tc, const char *str)
 {
   size_t nbyte = str ? strlen(str) + 1 : 0;
-  void *mem = nbyte ? malloc(nbyte) : NULL;
-  if (mem != NULL || nbyte == 0)
-    return (char *) memcpy(mem, str, nbyte);
-  fprintf(stderr, "my_strdup('%s'): out of memory\n", str);
-  exit(1);
+  char *mem = tc->arena + tc->arena_used;
+  if (str == NULL)
+    return NULL;
+  if (nbyte > sizeof tc->arena - tc->arena_used)
+    fprintf(stderr, "test_strdup('%s'): arena full\n", str), exit(1);
+  tc->arena_used += nbyte;
+  return (char *) memcpy(mem, str, nbyte);
 }
 
 /* Call this on values actually returned by the option parser. */
@@ -195,7 +243,7 @@ actual(struct testcase *tc, enum argtype type, const char *val)
   size_t i = tc->actual_cnt++;
   assert(i < sizeof tc->actual / sizeof *tc->actual);
   tc->actual[i].type = type;
-  tc->actual[i].val = my_strdup(val);
+  tc->actual[i].val = test_strdup(tc, val);
 }
 
 /* Call this on what we _expect_ the command parser to return. */
@@ -205,7 +253,7 @@ expect(struct testcase *tc, enum argtype type, const char *val)
   size_t i = tc->expect_cnt++;
   assert(i < sizeof tc->expect / sizeof *tc->expect);
   tc->expect[i].type = type;
-  tc->expect[i].val = my_strdup(val);
+  tc->expect[i].val = test_strdup(tc, val);
 }
 
 #define actual_opt(tc, opt)       (actual(tc, ARGTYPE_OPT, opt))
@@ -222,12 +270,12 @@ test_begin(struct testcase *tc, ...)
 {
   const char *arg;
   va_list ap;
-  memset(tc, 0, sizeof *tc);
-  tc->argv[tc->argc++] = my_strdup("copt");
+  tc->expect_cnt = tc->actual_cnt = tc->argc = tc->arena_used = 0;
+  tc->argv[tc->argc++] = test_strdup(tc, "copt");
   va_start(ap, tc);
   while ((arg = va_arg(ap, char *)) != NULL) {
     assert(tc->argc < sizeof tc->argv / sizeof *tc->argv);
-    tc->argv[tc->argc++] = my_strdup(arg);
+    tc->argv[tc->argc++] = test_strdup(tc, arg);
   }
   va_end(ap);
 }
@@ -239,7 +287,7 @@ test_addargs(struct testcase *tc, char **argv)
 {
   while (*argv != NULL) {
     assert(tc->argc < sizeof tc->argv / sizeof *tc->argv);
-    tc->argv[tc->argc++] = my_strdup(*argv++);
+    tc->argv[tc->argc++] = test_strdup(tc, *argv++);
   }
 }
 
@@ -280,7 +328,6 @@ test_verify(struct testcase *tc)
   char buf[71];
   size_t i;
   total_test_cnt++;
-  sprint_args(buf, sizeof buf, tc->argc, tc->argv, sizeof buf-1);
 
   if (tc->expect_cnt == tc->actual_cnt) {
     /* Check if actual args differ from expected args. */
@@ -288,11 +335,15 @@ test_verify(struct testcase *tc)
       if (!arg_eq(&tc->expect[i], &tc->actual[i]))
         break;
     if (i == tc->expect_cnt) {
-      printf("%s: OK\n", buf);
+      if (test_verbose) {
+        sprint_args(buf, sizeof buf, tc->argc, tc->argv, sizeof buf-1);
+        printf("%s: OK\n", buf);
+      }
       return;
     }
   }
   /* Test failed.  Log formatted table of expected vs actual args. */
+  sprint_args(buf, sizeof buf, tc->argc, tc->argv, sizeof buf-1);
   fflush(stdout);
   fprintf(stderr, "%s: FAIL\n", buf);
   flog("%s:%d: ", __FILE__, test_line);
@@ -321,15 +372,39 @@ noarg_handler(const struct copt *opt, void *aux)
 static void
 test_end(struct testcase *tc, int reorder)
 {
+  /* Must be in same order as if/else chain below. */
+  static const char *const specs[] = {
+    "x", "y", "z", "longopt", "m|multiple-opts", "s", "long-with-arg",
+    "a|multiple-with-arg", "o|optional-arg"
+  };
+  const int nspec = (int) (sizeof specs / sizeof *specs);
+  static struct copt_slot slots[16];
+  static struct copt_tab tab;
+  char *scratch[64];
+  const char *nonopts[64];
   struct copt opt;
   size_t i;
+  int id;
+
+  if (tab.slots == NULL && copt_tab_init(&tab, specs, nspec, slots, 16))
+    fprintf(stderr, "copt_tab_init() failed\n"), exit(1);
   for (i = tc->argc; i < sizeof tc->argv / sizeof *tc->argv; i++)
     tc->argv[i] = (char *) "@@@@@@@ OUT-OF-BOUNDS @@@@@@@";
   memcpy(tc->argv_copy, tc->argv, sizeof tc->argv);
 
-  opt = copt_init((int) tc->argc, tc->argv_copy, reorder);
+  if (reorder == 3)  /* reorder without modifying argv */
+    opt = copt_init_const((int) tc->argc, (const char *const *) tc->argv_copy,
+                          nonopts, (int) (sizeof nonopts / sizeof *nonopts));
+  else
+    opt = copt_init((int) tc->argc, tc->argv_copy, reorder);
   copt_set_noargfn(&opt, noarg_handler, NULL);
+  if (reorder == 2)
+    copt_set_scratch(&opt, scratch, (int) (sizeof scratch / sizeof *scratch));
   while (copt_next(&opt)) {
+    for (id = 0; id < nspec && !copt_opt(&opt, specs[id]); id++)
+      continue;
+    if (copt_id(&opt, &tab) != (id < nspec ? id : -1))
+      actual_badopt(tc, "copt_id() mismatch");
     if (copt_opt(&opt, "x")) {
       actual_opt(tc, "x");
     } else if (copt_opt(&opt, "y")) {
@@ -356,16 +431,12 @@ test_end(struct testcase *tc, int reorder)
       actual_badopt(tc, copt_curopt(&opt));
     }
   }
-  for (i = copt_idx(&opt); i < tc->argc; i++)
-    actual_arg(tc, tc->argv_copy[i]);
+  for (i = 0; i < (size_t) copt_nonopt_count(&opt); i++)
+    actual_arg(tc, copt_nonopt_at(&opt, (int) i));
+  if (reorder == 3 && memcmp(tc->argv, tc->argv_copy, sizeof tc->argv))
+    actual_badopt(tc, "copt_init_const() modified argv");
 
   test_verify(tc);
-  for (i = 0; i < tc->argc; i++)
-    free(tc->argv[i]);
-  for (i = 0; i < tc->expect_cnt; i++)
-    free((void *) tc->expect[i].val); /* discard const */
-  for (i = 0; i < tc->actual_cnt; i++)
-    free((void *) tc->actual[i].val); /* discard const */
 }
 
 static void
@@ -619,6 +690,13 @@ run_copt_tests(int reorder)
   expect_arg(&tc, "-y");
   test_end(&tc, reorder);
 
+  /* optspec separators in option names never match */
+  test_begin(&tc, "--m|multiple-opts", "--multiple-opts|", "-x", NULL);
+  expect_badopt(&tc, "--m|multiple-opts");
+  expect_badopt(&tc, "--multiple-opts|");
+  expect_opt(&tc, "x");
+  test_end(&tc, reorder);
+
   /* unknown short and long options */
   for (i = 0; i < 2; i++) {
     static const char *unknown[2] = { "-q", "--unknown-opt" };
@@ -1220,12 +1298,1122 @@ run_copt_tests(int reorder)
   }
 }
 
+/* Check copt_id() edge cases not covered by test_end(). */
+static void
+run_tab_tests(void)
+{
+  static const char *const specs[] = {"a|all", "b|all|x", "al", "x"};
+  static char *argv[] = {
+    (char *) "copt", (char *) "--all", (char *) "-x", (char *) "--al=1",
+    (char *) "--a", (char *) "--xy"
+  };
+  static const int expect[] = {0, 1, 2, 0, -1};
+  struct copt_slot slots[4];
+  struct copt_tab tab;
+  struct copt opt;
+  int i, id;
+
+  test_check(__LINE__, copt_tab_init(&tab, specs, 4, slots, 2) == -1,
+             "copt_tab_init() didn't fail with too few slots");
+  assert(copt_tab_init(&tab, specs, 4, slots, 3) == 0);
+  opt = copt_init(6, argv, 0);
+  for (i = 0; copt_next(&opt); i++) {
+    id = copt_id(&opt, &tab);
+    test_check(__LINE__, i < 5 && id == expect[i],
+               "copt_id(%s) returned %d", copt_curopt(&opt), id);
+  }
+  test_check(__LINE__, i == 5, "copt_next() found %d options, not 5", i);
+}
+
+/* Check copt_id() with prefix matching from copt_tab_prefix(). */
+static void
+run_prefix_tests(void)
+{
+  static const char *const specs[] = {
+    "o|out|outfile", "output-dir", "v|verbose", "version", "x"
+  };
+  static char *argv[] = {
+    (char *) "copt", (char *) "--outf=a", (char *) "--out", (char *) "--o",
+    (char *) "--output", (char *) "--outp", (char *) "--ou",
+    (char *) "--verb", (char *) "--vers", (char *) "--ver", (char *) "--x",
+    (char *) "-v", (char *) "-e", (char *) "--e", (char *) "--outfiles",
+    (char *) "--=out"
+  };
+  static const int expect[] = {
+    0, 0, 0, 1, 1, COPT_AMBIGUOUS, 2, 3, COPT_AMBIGUOUS, 4, 2, -1, -1, -1,
+    -1
+  };
+  const int nspec = (int) (sizeof specs / sizeof *specs);
+  const int nexpect = (int) (sizeof expect / sizeof *expect);
+  struct copt_slot slots[16];
+  struct copt_node nodes[32];
+  struct copt_tab tab;
+  struct copt opt;
+  int i = 0, id;
+
+  if (copt_tab_init(&tab, specs, nspec, slots, 16) != 0)
+    fprintf(stderr, "copt_tab_init() failed\n"), exit(1);
+  test_check(__LINE__, copt_tab_prefix(&tab, nodes, 16) == -1,
+             "copt_tab_prefix() didn't fail with too few nodes");
+  if (copt_tab_prefix(&tab, nodes, 32) != 0)
+    fprintf(stderr, "copt_tab_prefix() failed\n"), exit(1);
+  opt = copt_init(nexpect+1, argv, 0);
+  while (copt_next(&opt) && i < nexpect) {
+    id = copt_id(&opt, &tab);
+    test_check(__LINE__, id == expect[i], "copt_id(%s) returned %d, "
+               "expected %d", copt_curopt(&opt), id, expect[i]);
+    if (i++ == 0)
+      test_check(__LINE__, !strcmp(copt_arg(&opt), "a"),
+                 "copt_arg(--outf=a) didn't return \"a\"");
+  }
+  test_check(__LINE__, i == nexpect, "copt_next() found %d options", i);
+}
+
+/* Return Levenshtein distance between A and B the slow, obvious way. */
+static int
+slow_edit_dist(const char *a, const char *b)
+{
+  int row[64], i, j, diag, tmp;
+  size_t n = strlen(b);
+  assert(n < sizeof row / sizeof *row);
+  for (j = 0; j <= (int) n; j++)
+    row[j] = j;
+  for (i = 1; a[i-1] != '\0'; i++) {
+    diag = row[0];
+    row[0] = i;
+    for (j = 1; j <= (int) n; j++) {
+      tmp = row[j];
+      row[j] = diag + (a[i-1] != b[j-1]);
+      row[j] = row[j] < row[j-1]+1 ? row[j] : row[j-1]+1;
+      row[j] = row[j] < tmp+1 ? row[j] : tmp+1;
+      diag = tmp;
+    }
+  }
+  return row[n];
+}
+
+/* Check that copt_suggest() finds NAME for unknown option "--OPT" with
+   MAXDIST iff NAME is that close. */
+static void
+test_suggest_dist(const char *opt, const char *name, int maxdist)
+{
+  char arg[64], *argv[3];
+  const char *specs[1];
+  struct copt_slot out[1];
+  struct copt copt;
+  int found, expect = slow_edit_dist(opt, name) <= maxdist;
+  sprintf(arg, "--%s", opt);
+  argv[0] = (char *) "copt", argv[1] = arg, argv[2] = NULL;
+  specs[0] = name;
+  copt = copt_init(2, argv, 0);
+  assert(copt_next(&copt));
+  found = copt_suggest(&copt, specs, 1, maxdist, out, 1);
+  test_check(__LINE__, found == expect, "copt_suggest(--%s) with name %s "
+             "and maxdist %d returned %d, expected %d", opt, name, maxdist,
+             found, expect);
+}
+
+/* Check copt_suggest() on a few typos, then against slow_edit_dist() on
+   random strings. */
+static void
+run_suggest_tests(void)
+{
+  static const char *const specs[] = {
+    "o|outfile", "output-dir", "v|verbose", "version", "color", "colour"
+  };
+  static const struct {
+    const char *arg;
+    const char *expect[3]; /* expected names, NULL-terminated */
+  } cases[] = {
+    {"--outfle", {"outfile"}}, {"--verison", {"version"}},
+    {"--colr", {"color"}}, {"--clour", {"colour"}},
+    {"--colorr", {"color", "colour"}}, {"--xyzzy", {0}}, {"-q", {0}},
+    {"--outputdir=x", {"output-dir"}}
+  };
+  const int nspec = (int) (sizeof specs / sizeof *specs);
+  const int ncase = (int) (sizeof cases / sizeof *cases);
+  struct copt_slot out[3];
+  struct copt opt;
+  char *argv[3], name[32], typo[32];
+  int i, j, n;
+
+  for (i = 0; i < ncase; i++) {
+    argv[0] = (char *) "copt", argv[1] = (char *) cases[i].arg;
+    argv[2] = NULL;
+    opt = copt_init(2, argv, 0);
+    assert(copt_next(&opt));
+    n = copt_suggest(&opt, specs, nspec, 2, out, 3);
+    for (j = 0; j < n && cases[i].expect[j]; j++)
+      if ((int) strlen(cases[i].expect[j]) != out[j].len ||
+          memcmp(cases[i].expect[j], out[j].name, out[j].len))
+        break;
+    test_check(__LINE__, j == n && (j == 3 || !cases[i].expect[j]),
+               "copt_suggest(%s) gave %d names, first %.*s", cases[i].arg,
+               n, n ? out[0].len : 0, n ? out[0].name : "");
+  }
+  argv[1] = (char *) "--colorr";
+  opt = copt_init(2, argv, 0);
+  assert(copt_next(&opt));
+  test_check(__LINE__, copt_suggest(&opt, specs, nspec, 2, out, 1) == 1,
+             "copt_suggest(--colorr) with 1 slot didn't return 1");
+
+  srand(1);
+  for (i = 0; i < 20000; i++) {
+    int m = 1 + rand() % 24, len = 1 + rand() % 24;
+    for (j = 0; j < m; j++)
+      typo[j] = "ab-c"[rand() % 4];
+    for (j = 0; j < len; j++)
+      name[j] = "ab-c"[rand() % 4];
+    typo[m] = name[len] = '\0';
+    test_suggest_dist(typo, name, rand() % 8);
+  }
+}
+
+/* Check copt_init_const() falls back to not reordering if its non-option
+   array is too small.  test_end() covers the usual case. */
+static void
+run_const_tests(void)
+{
+  static const char *const argv[] = {"copt", "a", "-x", "--", "-y", NULL};
+  static const char *const expect[2][5] = {
+    {"a", "-x", "--", "-y"}, {"a", "-y"}
+  };
+  const char *nonopts[5];
+  struct copt opt;
+  int i, j, nopt;
+  for (i = 0; i < 2; i++) {
+    opt = copt_init_const(5, argv, nonopts, i ? 5 : 4);
+    for (nopt = 0; copt_next(&opt); nopt++)
+      continue;
+    for (j = 0; j < copt_nonopt_count(&opt) && expect[i][j]; j++)
+      if (strcmp(copt_nonopt_at(&opt, j), expect[i][j]))
+        break;
+    test_check(__LINE__, nopt == i && j == copt_nonopt_count(&opt) &&
+               !expect[i][j], "copt_init_const() with %d slots found %d "
+               "options and %d non-options", i ? 5 : 4, nopt,
+               copt_nonopt_count(&opt));
+  }
+}
+
+/* Count a bad numeric arg in int *AUX, and replace it with "7". */
+static char *
+badarg_handler(const struct copt *opt, void *aux)
+{
+  (void) opt;
+  ++*(int *) aux;
+  return (char *) "7";
+}
+
+/* Replace a bad numeric arg with string AUX. */
+static char *
+badarg_replace(const struct copt *opt, void *aux)
+{
+  (void) opt;
+  return (char *) aux;
+}
+
+/* Parse "--num=ARG" and convert ARG as KIND ('l', 'u', 'd' or 'z'), checking
+   the result prints as EXPECT, or that it's rejected if EXPECT is NULL. */
+static void
+test_num(int line, int kind, const char *arg, const char *expect)
+{
+  char *argv[2], num[64], got[64];
+  int nbad = 0;
+  struct copt opt;
+  sprintf(num, "--num=%s", arg);
+  argv[0] = (char *) "copt", argv[1] = num;
+  opt = copt_init(2, argv, 0);
+  copt_set_badargfn(&opt, badarg_handler, &nbad);
+  assert(copt_next(&opt) && copt_opt(&opt, "num"));
+  if (kind == 'l')
+    sprintf(got, "%ld", copt_arg_long(&opt));
+  else if (kind == 'u')
+    sprintf(got, "%lu", copt_arg_ulong(&opt));
+  else if (kind == 'd')
+    sprintf(got, "%g", copt_arg_double(&opt));
+  else
+    sprintf(got, "%lu", (unsigned long) copt_arg_size(&opt));
+  test_check(line, nbad == !expect && !strcmp(got, expect ? expect : "7"),
+             "converting '%s' as '%c' gave %s with %d bad arg calls", arg,
+             kind, got, nbad);
+}
+
+/* Convert numeric args, including edge cases and overflow. */
+static void
+run_num_tests(void)
+{
+  char max[32], min[32], over[40];
+  test_num(__LINE__, 'l', "0", "0");
+  test_num(__LINE__, 'l', "-0", "0");
+  test_num(__LINE__, 'l', "+12", "12");
+  test_num(__LINE__, 'l', "-0012", "-12");
+  test_num(__LINE__, 'l', "12x", NULL);
+  test_num(__LINE__, 'l', "", NULL);
+  test_num(__LINE__, 'l', "-", NULL);
+  test_num(__LINE__, 'l', " 1", NULL);
+  test_num(__LINE__, 'l', "0x10", NULL);
+  sprintf(max, "%ld", LONG_MAX);
+  sprintf(min, "%ld", LONG_MIN);
+  test_num(__LINE__, 'l', max, max);
+  test_num(__LINE__, 'l', min, min);
+  sprintf(over, "%s0", max);
+  test_num(__LINE__, 'l', over, NULL);
+  over[strlen(max)-1]++;      /* e.g. 2147483648, if no carry */
+  over[strlen(max)] = '\0';
+  test_num(__LINE__, 'l', over, NULL);
+  test_num(__LINE__, 'u', "42", "42");
+  test_num(__LINE__, 'u', "-1", NULL);
+  test_num(__LINE__, 'u', "+1", NULL);
+  sprintf(max, "%lu", ULONG_MAX);
+  test_num(__LINE__, 'u', max, max);
+  sprintf(over, "%s0", max);
+  test_num(__LINE__, 'u', over, NULL);
+  test_num(__LINE__, 'z', "4K", "4000");
+  test_num(__LINE__, 'z', "4Ki", "4096");
+  test_num(__LINE__, 'z', "2M", "2000000");
+  test_num(__LINE__, 'z', "3Mi", "3145728");
+  test_num(__LINE__, 'z', "1Gi", "1073741824");
+  test_num(__LINE__, 'z', "1Ki5", NULL);
+  test_num(__LINE__, 'z', "1k", NULL);
+  test_num(__LINE__, 'z', "K", NULL);
+  test_num(__LINE__, 'z', "1T", NULL);
+  test_num(__LINE__, 'z', "99999999999999999999Gi", NULL);
+  test_num(__LINE__, 'd', "1.5", "1.5");
+  test_num(__LINE__, 'd', "-2e3", "-2000");
+  test_num(__LINE__, 'd', "1e99999", NULL);
+  test_num(__LINE__, 'd', "1.5x", NULL);
+  test_num(__LINE__, 'd', "", NULL);
+}
+
+/* Bind options to variables, including bad ints and unknown options.
+   Ints use copt_arg_long()'s decimal-only grammar, so "0x10" is bad. */
+static void
+run_bind_tests(void)
+{
+  static char *argv[] = {
+    (char *) "copt", (char *) "-vv", (char *) "a", (char *) "--out=f",
+    (char *) "-n", (char *) "0x10", (char *) "--size=-5", (char *) "-qx",
+    (char *) "--color", (char *) "-n", (char *) "3000000000",
+    (char *) "--verbose", (char *) "b", (char *) "--num=-16"
+  };
+  static char *argv2[] = {(char *) "copt", (char *) "--num=y"};
+  int verbose = 0, quiet = 0, num = 0, nstop = 0, nbad = 0, ret;
+  long size = 0;
+  char *out = NULL, *color = (char *) "none";
+  struct copt_bind binds[6];
+  struct copt_slot slots[8];
+  struct copt_tab tab;
+  struct copt opt = copt_init(14, argv, 1);
+
+  binds[0].spec = "v|verbose", binds[0].kind = COPT_BIND_COUNT;
+  binds[1].spec = "q|quiet",   binds[1].kind = COPT_BIND_FLAG;
+  binds[2].spec = "o|out",     binds[2].kind = COPT_BIND_STR;
+  binds[3].spec = "c|color",   binds[3].kind = COPT_BIND_OSTR;
+  binds[4].spec = "n|num",     binds[4].kind = COPT_BIND_INT;
+  binds[5].spec = "s|size",    binds[5].kind = COPT_BIND_LONG;
+  binds[0].dst = &verbose, binds[1].dst = &quiet, binds[2].dst = &out;
+  binds[3].dst = &color, binds[4].dst = &num, binds[5].dst = &size;
+
+  test_check(__LINE__, copt_tab_bind(&tab, binds, 6, slots, 4) == -1,
+             "copt_tab_bind() didn't fail with too few slots");
+  assert(copt_tab_bind(&tab, binds, 6, slots, 8) == 0);
+  copt_set_badargfn(&opt, badarg_handler, &nbad);
+  while ((ret = copt_bind(&opt, binds, &tab)) == 1) {
+    test_check(__LINE__, !strcmp(copt_curopt(&opt), "-x"),
+               "copt_bind() stopped at %s", copt_curopt(&opt));
+    nstop++;
+  }
+  test_check(__LINE__, ret == 0 && nstop == 1 && nbad == 2,
+             "copt_bind() returned %d after %d stops and %d bad args", ret,
+             nstop, nbad);
+  test_check(__LINE__, verbose == 3 && quiet == 1 && out &&
+             !strcmp(out, "f") && color == NULL && num == -16 && size == -5,
+             "copt_bind() set verbose=%d quiet=%d num=%d size=%ld", verbose,
+             quiet, num, size);
+  test_check(__LINE__, copt_nonopt_count(&opt) == 2 &&
+             !strcmp(copt_nonopt_at(&opt, 1), "b"),
+             "copt_bind() left %d non-options", copt_nonopt_count(&opt));
+
+  /* A bad arg that badargfn can't fix zeroes the destination. */
+  opt = copt_init(2, argv2, 0);
+  copt_set_badargfn(&opt, badarg_replace, (void *) "z");
+  ret = copt_bind(&opt, binds, &tab);
+  test_check(__LINE__, ret == 0 && num == 0,
+             "copt_bind() returned %d and set num=%d", ret, num);
+}
+
+/* Split a command string in place and parse it. */
+static void
+run_split_tests(void)
+{
+  static const char *const expect[] = {
+    "cmd", "-x", "single quoted", "double \"quoted\"", "back slash", "",
+    "--long=a bc", "it's", "a\\", NULL
+  };
+  char buf[128], *argv[10];
+  struct copt opt;
+  int i, argc, nopt = 0;
+
+  strcpy(buf, "  cmd -x 'single quoted' \"double \\\"quoted\\\"\"\n"
+              "\tback\\ slash ''  --long=\"a b\"c it\\'s a\\\\\r\n");
+  argc = copt_split(buf, argv, 10);
+  for (i = 0; i < argc && expect[i]; i++)
+    if (strcmp(argv[i], expect[i]))
+      break;
+  test_check(__LINE__, argc == 9 && i == 9 && argv[9] == NULL,
+             "copt_split() returned %d, mismatch at arg %d", argc, i);
+  opt = copt_init(argc, argv, 1);
+  while (copt_next(&opt))
+    nopt += copt_opt(&opt, "x") || copt_opt(&opt, "long");
+  test_check(__LINE__, nopt == 2 && copt_nonopt_count(&opt) == 6,
+             "parsing split args found %d options and %d non-options",
+             nopt, copt_nonopt_count(&opt));
+
+  /* Backslashes are literal inside '...', and inside "..." unless before
+     one of \\ \" $ ` or newline, as in sh. */
+  strcpy(buf, "'C:\\dir\\x' \"a\\b\" \"\\\\\\\"\\$\\`\" 'a\\' "
+              "\"li\\\nne\" x\\\ny");
+  argc = copt_split(buf, argv, 10);
+  test_check(__LINE__, argc == 6 && !strcmp(argv[0], "C:\\dir\\x") &&
+             !strcmp(argv[1], "a\\b") && !strcmp(argv[2], "\\\"$`") &&
+             !strcmp(argv[3], "a\\") && !strcmp(argv[4], "line") &&
+             !strcmp(argv[5], "xy"), "copt_split() quoting doesn't match sh");
+
+  strcpy(buf, "a b");
+  test_check(__LINE__, copt_split(buf, argv, 2) == -1,
+             "copt_split() didn't fail with no room for NULL terminator");
+  strcpy(buf, " \t");
+  test_check(__LINE__, copt_split(buf, argv, 1) == 0 && argv[0] == NULL,
+             "copt_split() found args in blank string");
+}
+
+/* Append " ARG" to string AUX. */
+static void
+log_nonopt(const struct copt *opt, char *arg, void *aux)
+{
+  (void) opt;
+  strcat(strcat((char *) aux, " "), arg);
+}
+
+/* Get non-options from a callback in order, interleaved with options. */
+static void
+run_nonoptfn_tests(void)
+{
+  static char *argv[] = {
+    (char *) "copt", (char *) "a", (char *) "-x", (char *) "-", (char *) "b",
+    (char *) "-o", (char *) "out", (char *) "c", (char *) "--",
+    (char *) "-y", (char *) "--", (char *) "d"
+  };
+  char log[128] = "";
+  struct copt opt = copt_init(12, argv, 1);
+
+  copt_set_nonoptfn(&opt, log_nonopt, log);
+  while (copt_next(&opt)) {
+    strcat(log, copt_opt(&opt, "x") ? " X" : " ?");
+    if (copt_opt(&opt, "o"))
+      strcat(strcat(log, ":"), copt_arg(&opt));
+  }
+  test_check(__LINE__, !strcmp(log, " a X - b ?:out c -y -- d") &&
+             copt_idx(&opt) == 12 && argv[1][0] == 'a',
+             "copt_set_nonoptfn() got events \"%s\"", log);
+}
+
+/* Dispatch subcommands with global options before and after them. */
+static void
+run_subcmd_tests(void)
+{
+  static const char *const cmds[] = {"commit|ci", "log", "x"};
+  static char *argv1[] = {
+    (char *) "copt", (char *) "-v", (char *) "ci", (char *) "file",
+    (char *) "-m", (char *) "msg", (char *) "--verbose"
+  };
+  static char *argv2[] = {(char *) "copt", (char *) "nope", (char *) "-v"};
+  struct copt_slot slots[4];
+  struct copt_tab tab;
+  struct copt opt, sub;
+  char *msg = NULL;
+  int verbose = 0, id;
+
+  assert(copt_tab_init(&tab, cmds, 3, slots, 4) == 0);
+  opt = copt_init(7, argv1, 0);
+  while (copt_next(&opt))
+    verbose += copt_opt(&opt, "v|verbose");
+  id = copt_subcmd(&opt, &tab, 1, &sub);
+  while (copt_next(&sub)) {
+    if (copt_opt(&sub, "m|message"))
+      msg = copt_arg(&sub);
+    else
+      verbose += copt_opt(&sub, "v|verbose");  /* global option */
+  }
+  test_check(__LINE__, id == 0 && verbose == 2 && msg &&
+             !strcmp(msg, "msg") && copt_nonopt_count(&sub) == 1 &&
+             !strcmp(copt_nonopt_at(&sub, 0), "file"),
+             "copt_subcmd() returned %d, found -v %d times", id, verbose);
+
+  opt = copt_init(3, argv2, 0);
+  assert(!copt_next(&opt));
+  test_check(__LINE__, copt_subcmd(&opt, &tab, 1, &sub) == -1,
+             "copt_subcmd() found unknown subcommand");
+  opt = copt_init(2, argv1, 0);
+  assert(copt_next(&opt) && !copt_next(&opt));
+  test_check(__LINE__, copt_subcmd(&opt, &tab, 1, &sub) == -1 &&
+             !copt_next(&sub), "copt_subcmd() found missing subcommand");
+  argv2[1] = (char *) "x";
+  opt = copt_init(3, argv2, 0);
+  assert(!copt_next(&opt));
+  test_check(__LINE__, copt_subcmd(&opt, &tab, 1, &sub) == 2,
+             "copt_subcmd() didn't find one-letter subcommand");
+}
+
+/* Check copt_complete() on the last of the NULL-terminated WORDS returns
+   EXPECT, with *AT being name EXPECT_NAME or, if EXPECT is
+   COPT_COMPLETE_ARG, optspec EXPECT_ID. */
+static void
+test_complete(int line, const char *const *words, int expect,
+              const char *expect_name, int expect_id)
+{
+  static const char *const specs[] = {
+    "v|verbose", "o|output", "c|color", "version", "x", "verbose|verb"
+  };
+  static const unsigned char kinds[] = {
+    COPT_ARG_NONE, COPT_ARG_REQUIRED, COPT_ARG_OPTIONAL, COPT_ARG_NONE,
+    COPT_ARG_NONE, COPT_ARG_NONE
+  };
+  struct copt_slot names[16];
+  char *argv[8];
+  int argc, nname, at = -9, got;
+  for (argc = 0; words[argc] != NULL; argc++)
+    argv[argc] = (char *) words[argc];
+  test_check(line, copt_names_init(specs, 6, names, 8) == -1,
+             "copt_names_init() didn't fail with too few names");
+  nname = copt_names_init(specs, 6, names, 16);
+  test_check(line, nname == 9, "copt_names_init() returned %d", nname);
+  got = copt_complete(names, nname, kinds, argc, argv, &at);
+  test_check(line, got == expect &&
+             (got != COPT_COMPLETE_ARG || at == expect_id) &&
+             (got <= 0 || (at >= 0 && at+got <= nname &&
+                           names[at].len == (int) strlen(expect_name) &&
+                           !memcmp(names[at].name, expect_name,
+                                   names[at].len))),
+             "completing '%s' returned %d with *at=%d, expected %d",
+             argc > 0 ? argv[argc-1] : "", got, at, expect);
+}
+
+#define TEST_COMPLETE(words, expect, name, id) do {            \
+    static const char *const words_[] = words;                \
+    test_complete(__LINE__, words_, (expect), (name), (id));  \
+  } while (0)
+#define W(a) {"prog", a, NULL}
+#define W2(a, b) {"prog", a, b, NULL}
+#define W3(a, b, c) {"prog", a, b, c, NULL}
+
+/* Complete option names and find option args. */
+static void
+run_complete_tests(void)
+{
+  static const char *const none[] = {"prog", NULL};
+  const int arg = COPT_COMPLETE_ARG;
+  test_complete(__LINE__, none, 0, "", 0);
+  TEST_COMPLETE(W("--ver"), 3, "verb", 0);
+  TEST_COMPLETE(W("--verbose"), 1, "verbose", 0);
+  TEST_COMPLETE(W("--output"), 1, "output", 0);
+  TEST_COMPLETE(W("-"), 9, "c", 0);
+  TEST_COMPLETE(W("--"), 5, "color", 0);
+  TEST_COMPLETE(W("--v"), 3, "verb", 0);
+  TEST_COMPLETE(W("--z"), 0, "", 0);
+  TEST_COMPLETE(W("file"), 0, "", 0);
+  TEST_COMPLETE(W("-o"), 1, "o", 0);
+  TEST_COMPLETE(W("-xo"), 0, "", 0);
+  TEST_COMPLETE(W("-oFILE"), arg, "", 1);
+  TEST_COMPLETE(W("-xcfoo"), arg, "", 2);
+  TEST_COMPLETE(W("--output=fi"), arg, "", 1);
+  TEST_COMPLETE(W("--color="), arg, "", 2);
+  TEST_COMPLETE(W("--verbose=x"), 0, "", 0);
+  TEST_COMPLETE(W2("-o", ""), arg, "", 1);
+  TEST_COMPLETE(W2("--output", "fi"), arg, "", 1);
+  TEST_COMPLETE(W2("-xo", "fi"), arg, "", 1);
+  TEST_COMPLETE(W2("-o", "-"), arg, "", 1);
+  TEST_COMPLETE(W2("-o", "--ver"), 3, "verb", 0);
+  TEST_COMPLETE(W2("-c", "fi"), 0, "", 0);
+  TEST_COMPLETE(W2("--", "--ver"), 0, "", 0);
+  TEST_COMPLETE(W2("--output=x", "--ve"), 3, "verb", 0);
+  TEST_COMPLETE(W3("-o", "x", "--ver"), 3, "verb", 0);
+  TEST_COMPLETE(W3("file", "-o", "f"), arg, "", 1);
+  TEST_COMPLETE(W3("a", "b", "-"), 9, "c", 0);
+  TEST_COMPLETE(W3("-o", "--", "--ver"), 0, "", 0);
+  TEST_COMPLETE(W3("a", "--", "-o"), 0, "", 0);
+}
+
+#undef W
+#undef W2
+#undef W3
+
+/* Parse three lines in one batch, then again with too few records. */
+static void
+run_batch_tests(void)
+{
+  static const char *const specs[] = {"v|verbose", "o|output", "c|color"};
+  static const unsigned char kinds[] = {
+    COPT_ARG_NONE, COPT_ARG_REQUIRED, COPT_ARG_OPTIONAL
+  };
+  static char *line0[] = {
+    (char *) "copt", (char *) "-v", (char *) "a", (char *) "-o",
+    (char *) "f", (char *) "--color=x", (char *) "b", NULL
+  };
+  static char *line1[] = {
+    (char *) "copt", (char *) "-q", (char *) "--", (char *) "-v", NULL
+  };
+  static char *line2[] = {(char *) "copt", (char *) "-o", NULL};
+  static char *const *const argvs[] = {line0, line1, line2};
+  static const struct {int id; const char *arg;} expect[] = {
+    {0, NULL}, {1, "f"}, {2, "x"}, {COPT_NONOPT, "a"}, {COPT_NONOPT, "b"},
+    {-1, "-q"}, {COPT_NONOPT, "-v"}, {1, NULL}
+  };
+  static const int expect_ends[] = {5, 7, 8};
+  struct copt_slot slots[6];
+  struct copt_tab tab;
+  struct copt_rec recs[8];
+  const char *nonopts[8];
+  int ends[3], i, nline;
+
+  assert(copt_tab_init(&tab, specs, 3, slots, 6) == 0);
+  nline = copt_parse_batch(&tab, kinds, 3, argvs, nonopts, 8, recs, 8, ends);
+  for (i = 0; nline == 3 && i < 8; i++) {
+    if (recs[i].id != expect[i].id || (recs[i].arg == NULL) !=
+        (expect[i].arg == NULL) || (recs[i].arg &&
+        strcmp(recs[i].arg, expect[i].arg)))
+      break;
+  }
+  test_check(__LINE__, nline == 3 && i == 8 &&
+             !memcmp(ends, expect_ends, sizeof ends),
+             "copt_parse_batch() parsed %d lines, record %d of 8 was wrong",
+             nline, i);
+  test_check(__LINE__, !strcmp(line0[2], "a"),
+             "copt_parse_batch() reordered argv");
+  nline = copt_parse_batch(&tab, kinds, 3, argvs, nonopts, 8, recs, 6, ends);
+  test_check(__LINE__, nline == 1 && ends[0] == 5, "copt_parse_batch() "
+             "parsed %d lines with too few records, expected 1", nline);
+}
+
+#ifdef COPT_STATS
+/* Parse ARGV (NULL-terminated) with REORDER and SCRATCH, matching each
+   option against "x" then "longopt", and check copt_stats() is EXPECT. */
+static void
+test_stats(int line, const char **argv, int reorder, int scratch,
+           const struct copt_stats *expect)
+{
+  char *args[16], *park[16];
+  struct copt opt;
+  struct copt_stats got;
+  int argc = 0;
+  while ((args[argc] = (char *) argv[argc]) != NULL)
+    argc++;
+  opt = copt_init(argc, args, reorder);
+  if (scratch)
+    copt_set_scratch(&opt, park, 16);
+  while (copt_next(&opt))
+    if (!copt_opt(&opt, "x"))
+      copt_opt(&opt, "longopt");
+  got = copt_stats(&opt);
+  test_check(line, !memcmp(&got, expect, sizeof got), "copt_stats() gave "
+             "args=%lu specs=%lu bytes=%lu rotations=%lu moved=%lu scans=%lu",
+             got.args, got.specs, got.bytes, got.rotations, got.moved,
+             got.scans);
+}
+
+/* Check COPT_STATS counters on a few small command lines. */
+static void
+run_stats_tests(void)
+{
+  static const char *argv1[] = {"copt", "-x", "--longopt", "file", NULL};
+  static const char *argv2[] = {"copt", "a", "b", "-x", "c", "-y", NULL};
+  struct copt_stats expect;
+  memset(&expect, 0, sizeof expect);
+  expect.args = 3;      /* -x, --longopt, file */
+  expect.specs = 3;     /* "x"; "x", "longopt" */
+  expect.bytes = 2+2+8; /* each name plus its terminator */
+  test_stats(__LINE__, argv1, 0, 0, &expect);
+  expect.rotations = 2; /* nothing to move past, but still called */
+  expect.scans = 1;     /* file */
+  test_stats(__LINE__, argv1, 1, 0, &expect);
+
+  expect.rotations = 2; /* -x past a b, then -y past a b c */
+  expect.moved = (2+3) * sizeof(char *);
+  expect.scans = 2+3+3; /* rescans a b c every time */
+  test_stats(__LINE__, argv2, 1, 0, &expect);
+  expect.rotations = 0;
+  expect.moved = (3+2+3) * sizeof(char *); /* a b -x; c -y; a b c */
+  expect.scans = 2+1+0; /* a b; c; none after parking them */
+  test_stats(__LINE__, argv2, 1, 1, &expect);
+}
+
+/* Layouts of huge command lines for run_scale_tests(). */
+enum scale_layout { OPTS_FIRST, OPTS_LAST, INTERLEAVED, SHORT_GROUPS };
+static const char *const scale_layouts[] = {
+  "options first", "options last", "interleaved", "short groups"
+};
+static const char *const scale_modes[] = {
+  "reorder=0", "reorder=1", "reorder=1+scratch", "const", "nonoptfn"
+};
+
+/* Count non-options passed to copt_set_nonoptfn() callback. */
+static void
+count_nonopt(const struct copt *opt, char *arg, void *aux)
+{
+  ++*(unsigned long *) aux;
+  (void) opt, (void) arg;
+}
+
+/* Fill ARGV with program name and N-1 args in LAYOUT, a quarter of them
+   non-options except when INTERLEAVED, where every other arg is one. */
+static void
+scale_args(char **argv, int n, enum scale_layout layout)
+{
+  static char group[] = "-abcdefgh";
+  int i, nonopt;
+  argv[0] = (char *) "copt";
+  for (i = 1; i < n; i++) {
+    if (layout == INTERLEAVED)
+      nonopt = i % 2;
+    else if (layout == OPTS_LAST)
+      nonopt = i <= n/4;
+    else
+      nonopt = i >= n - n/4;
+    if (nonopt)
+      argv[i] = (char *) "file";
+    else if (layout == SHORT_GROUPS)
+      argv[i] = group;
+    else
+      argv[i] = (char *) (i % 3 ? "-x" : "--long=val");
+  }
+}
+
+/* Parse N args from ARGV in MODE, using WORK and PARK as scratch space,
+   and return total operations counted by copt_stats(). */
+static unsigned long
+scale_work(char **argv, char **work, char **park, int n, int mode)
+{
+  struct copt opt;
+  struct copt_stats st;
+  unsigned long nonopts = 0;
+  memcpy(work, argv, n * sizeof *work);
+  if (mode == 3)
+    opt = copt_init_const(n, (const char *const *) work,
+                          (const char **) park, n);
+  else
+    opt = copt_init(n, work, mode != 0);
+  if (mode == 2)
+    copt_set_scratch(&opt, park, n);
+  if (mode == 4)
+    copt_set_nonoptfn(&opt, count_nonopt, &nonopts);
+  while (copt_next(&opt))
+    if (!copt_opt(&opt, "x"))
+      copt_opt(&opt, "long");
+  st = copt_stats(&opt);
+  return st.args + st.specs + st.bytes + st.rotations +
+         st.moved / sizeof *work + st.scans;
+}
+
+/* Parse command lines from 1K to 1M args in each mode and layout, and
+   check the operation count grows linearly.  Parking args in scratch and
+   copying them back count as moves, so re-copying them would show up.
+   Reordering by rotation is quadratic in the number of non-options before
+   each option by design, so it's only checked for being no worse than
+   that, on fewer args. */
+static void
+run_scale_tests(void)
+{
+  enum { MIN_ARGS = 1 << 10, MAX_ARGS = 1 << 20, MAX_ROTATE = 1 << 14 };
+  char **argv = (char **) malloc(3 * MAX_ARGS * sizeof *argv);
+  unsigned long work, prev;
+  int layout, mode, n, quadratic;
+  double limit;
+  assert(argv != NULL);
+  for (layout = OPTS_FIRST; layout <= SHORT_GROUPS; layout++) {
+    for (mode = 0; mode < 5; mode++) {
+      quadratic = mode == 1 && (layout == OPTS_LAST || layout == INTERLEAVED);
+      for (prev = 0, n = MIN_ARGS; n <= (quadratic ? MAX_ROTATE : MAX_ARGS);
+           n *= 4, prev = work) {
+        scale_args(argv, n, (enum scale_layout) layout);
+        work = scale_work(argv, argv + MAX_ARGS, argv + 2*MAX_ARGS, n, mode);
+        if (prev == 0)
+          continue;
+        limit = quadratic ? 4.0*4.0*1.25 : 4.0*1.25;
+        test_check(__LINE__, (double) work <= limit * (double) prev,
+                   "%s layout in %s mode took %lu ops for %d args, but %lu "
+                   "for %d", scale_layouts[layout], scale_modes[mode], work,
+                   n, prev, n/4);
+      }
+    }
+  }
+  free(argv);
+}
+#endif /* COPT_STATS */
+
+#ifdef COPT_HAVE_MMAP
+/* Write nul-terminated CONTENT to file PATH. */
+static void
+write_file(const char *path, const char *content)
+{
+  FILE *fp = fopen(path, "wb");
+  if (!fp || fputs(content, fp) == EOF || fclose(fp) == EOF)
+    fprintf(stderr, "can't write %s\n", path), exit(1);
+}
+
+/* Don't let C and C++ tests clobber each other's files with make -j. */
+#ifdef __cplusplus
+# define RSP(n) "copt-test-cpp-" #n ".rsp"
+#else
+# define RSP(n) "copt-test-" #n ".rsp"
+#endif
+
+/* Write N bytes at DATA to file PATH. */
+static void
+write_bytes(const char *path, const char *data, size_t n)
+{
+  FILE *fp = fopen(path, "wb");
+  if (!fp || fwrite(data, 1, n, fp) != n || fclose(fp) == EOF)
+    fprintf(stderr, "can't write %s\n", path), exit(1);
+}
+
+static int stream_nonopts; /* get non-options via copt_set_nonoptfn() */
+
+/* Log non-option ARG to testcase AUX. */
+static void
+stream_nonopt(const struct copt *opt, char *arg, void *aux)
+{
+  (void) opt;
+  actual_arg((struct testcase *) aux, arg);
+}
+
+/* Parse N bytes of nul-separated args at DATA with copt_init_fd() using a
+   CAP-byte buffer.  Return copt_stream_err(), and log parsed values to
+   TC as test_end() would. */
+static int
+parse_stream(struct testcase *tc, const char *data, size_t n, size_t cap)
+{
+  char buf[64];
+  struct copt_stream st;
+  struct copt opt;
+  char *arg;
+  int fd;
+  assert(cap <= sizeof buf);
+  memcpy(tc->argv_copy, tc->argv, sizeof tc->argv); /* for test_verify() */
+  write_bytes(RSP(stream), data, n);
+  if ((fd = open(RSP(stream), O_RDONLY)) < 0)
+    fprintf(stderr, "can't open %s\n", RSP(stream)), exit(1);
+  opt = copt_init_fd((char *) "copt", fd, &st, buf, (unsigned long) cap);
+  copt_set_noargfn(&opt, noarg_handler, NULL);
+  if (stream_nonopts)
+    copt_set_nonoptfn(&opt, stream_nonopt, tc);
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "x")) {
+      actual_opt(tc, "x");
+    } else if (copt_opt(&opt, "s")) {
+      actual_opt(tc, "s");
+      actual_optarg(tc, copt_arg(&opt));
+    } else if (copt_opt(&opt, "o|optional-arg")) {
+      actual_opt(tc, "o|optional-arg");
+      actual_optarg(tc, copt_oarg(&opt));
+    } else if (copt_opt(&opt, "long-with-arg")) {
+      actual_opt(tc, "long-with-arg");
+      actual_optarg(tc, copt_arg(&opt));
+    } else {
+      actual_badopt(tc, copt_curopt(&opt));
+    }
+  }
+  while ((arg = copt_stream_arg(&opt)) != NULL)
+    actual_arg(tc, arg);
+  close(fd);
+  remove(RSP(stream));
+  return copt_stream_err(&st);
+}
+
+static void
+run_stream_tests(void)
+{
+  static const char args1[] = "-x\0--long-with-arg\0val\0-s\0sarg\0"
+    "-o=opt\0-xsyz\0--long-with-arg=-\0-\0-y\0last";
+  static const char args2[] = "--long-with-arg\0-x\0-xs\0--\0-y\0";
+  static const char args3[] = "-x\0waytoolongforbuffer\0-y\0";
+  char big[512], num[16];
+  struct testcase tc;
+  size_t i, n;
+
+  for (n = 24; n <= 64; n += 40) {
+    test_begin(&tc, NULL);
+    expect_opt(&tc, "x");
+    expect_opt(&tc, "long-with-arg");
+    expect_optarg(&tc, "val");
+    expect_opt(&tc, "s");
+    expect_optarg(&tc, "sarg");
+    expect_opt(&tc, "o|optional-arg");
+    expect_optarg(&tc, "opt");
+    expect_opt(&tc, "x");
+    expect_opt(&tc, "s");
+    expect_optarg(&tc, "yz");
+    expect_opt(&tc, "long-with-arg");
+    expect_optarg(&tc, "-");
+    expect_arg(&tc, "-");
+    expect_arg(&tc, "-y");
+    expect_arg(&tc, "last");
+    if (parse_stream(&tc, args1, sizeof args1 - 1, n) != 0)
+      expect_arg(&tc, "copt_stream_err() != 0");
+    test_verify(&tc);
+  }
+
+  test_begin(&tc, NULL);
+  expect_opt(&tc, "long-with-arg");
+  expect_optarg(&tc, NULL);
+  expect_opt(&tc, "x");
+  expect_opt(&tc, "x");
+  expect_opt(&tc, "s");
+  expect_optarg(&tc, NULL);
+  expect_arg(&tc, "-y");
+  if (parse_stream(&tc, args2, sizeof args2 - 1, 24) != 0)
+    expect_arg(&tc, "copt_stream_err() != 0");
+  test_verify(&tc);
+
+  test_begin(&tc, NULL);
+  expect_opt(&tc, "x");
+  if (parse_stream(&tc, args3, sizeof args3 - 1, 16) != 1)
+    expect_arg(&tc, "copt_stream_err() != 1");
+  test_verify(&tc);
+
+  /* many args through a small buffer, with and without nonoptfn */
+  for (stream_nonopts = 0; stream_nonopts < 2; stream_nonopts++) {
+    test_begin(&tc, NULL);
+    for (i = n = 0; i < 20; i++) {
+      sprintf(num, "%lu", (unsigned long) i);
+      expect_opt(&tc, "s");
+      expect_optarg(&tc, num);
+      n += sprintf(big+n, "-s%c%s%c", '\0', num, '\0');
+    }
+    for (i = 0; i < 20; i++) {
+      sprintf(num, "file%lu", (unsigned long) i);
+      expect_arg(&tc, num);
+      n += sprintf(big+n, "%s%c", num, '\0');
+    }
+    assert(n < sizeof big);
+    if (parse_stream(&tc, big, n, 16) != 0)
+      expect_arg(&tc, "copt_stream_err() != 0");
+    test_verify(&tc);
+  }
+  stream_nonopts = 0;
+}
+
+/* Check copt_expand() on NULL-terminated ARGV against EXPECT. */
+static void
+test_expand(int line, const char **argv, const char *const *expect)
+{
+  char *outv[16];
+  struct copt_map maps[2];
+  int i, argc = 0, outc;
+  while (argv[argc])
+    argc++;
+  outc = copt_expand(argc, (char **) argv, outv, 16, maps, 2);
+  for (i = 0; i < outc && i < 16 && expect[i]; i++)
+    if (strcmp(outv[i], expect[i]))
+      break;
+  test_check(line, i == outc && !expect[i] && outc < 16 &&
+             outv[outc] == NULL,
+             "copt_expand() returned %d, mismatch at arg %d", outc, i);
+  copt_unmap(maps, 2);
+}
+
+static void
+run_expand_tests(void)
+{
+  static const char *argv1[] = {"copt", "@" RSP(1), "-y", NULL};
+  static const char *const expect1[] = {
+    "copt", "-x", "single quoted", "double \"quoted\"", "back slash", "",
+    "nested", "--long=a bc", "-y", NULL
+  };
+  static const char *argv2[] = {"copt", "@" RSP(2), "@", "@nonexistent",
+                                "-@" RSP(2), NULL};
+  static const char *const expect2[] = {
+    "copt", "nested", "--long=a bc", "@", "@nonexistent", "-@" RSP(2), NULL
+  };
+  static const char *argv3[] = {"copt", "@" RSP(3), NULL};
+  static const char *argv4[] = {"copt", "@" RSP(4), NULL};
+  static const char *const expect4[] = { /* same as sh */
+    "copt", "C:\\dir\\x", "a\\b", "\\\"$`", "a\\", "line", "xy", NULL
+  };
+  char *outv[4];
+  struct copt_map maps[2];
+
+  write_file(RSP(1), "-x 'single quoted' \"double \\\"quoted\\\"\"\n"
+                     "\tback\\ slash ''  @" RSP(2));
+  write_file(RSP(2), "nested\r\n--long=\"a b\"c");
+  write_file(RSP(3), "@" RSP(3));
+  write_file(RSP(4), "'C:\\dir\\x' \"a\\b\" \"\\\\\\\"\\$\\`\" 'a\\' "
+                     "\"li\\\nne\" x\\\ny");
+  test_expand(__LINE__, argv1, expect1);
+  test_expand(__LINE__, argv2, expect2);
+  test_expand(__LINE__, argv4, expect4);
+
+  /* too many nested files, or OUTV too small */
+  test_check(__LINE__, copt_expand(2, (char **) argv3, outv, 4, maps, 2)
+             == -1, "copt_expand() didn't fail with too many nested files");
+  copt_unmap(maps, 2);
+  test_check(__LINE__, copt_expand(2, (char **) argv1, outv, 4, maps, 2) == 8
+             && !strcmp(outv[3], "double \"quoted\""),
+             "copt_expand() didn't count args past a small outv");
+  copt_unmap(maps, 2);
+
+  remove(RSP(1));
+  remove(RSP(2));
+  remove(RSP(3));
+  remove(RSP(4));
+}
+
+/* Parse a config file with the same copt_opt() branches as argv. */
+static void
+run_config_tests(void)
+{
+  static const char *const expect[] = {
+    RSP(4), "verbose", "out=a b", "color=", "level=3", "define=X=1", "=x",
+    "j=4", NULL
+  };
+  char *outv[10];
+  struct copt_map map;
+  struct copt opt;
+  int i, n, verbose = 0, level = 0;
+  char *out = NULL, *color = NULL, *define = NULL, *jobs = NULL, *bad = NULL;
+
+  write_file(RSP(4), "# comment\n\n  verbose\nout  a b \r\n\tcolor =\n"
+                     "level= 3\n  # indented comment\ndefine = X=1\n=x\nj=4");
+  n = copt_config(RSP(4), &map, outv, 10);
+  for (i = 0; i < n && expect[i]; i++)
+    if (strcmp(outv[i], expect[i]))
+      break;
+  test_check(__LINE__, n == 8 && i == 8 && outv[8] == NULL,
+             "copt_config() returned %d, mismatch at item %d", n, i);
+
+  opt = copt_init_config(n, outv);
+  copt_set_noargfn(&opt, noarg_handler, NULL);
+  for (i = 0; copt_next(&opt); i++) {
+    if (copt_opt(&opt, "v|verbose"))
+      verbose++;
+    else if (copt_opt(&opt, "o|out"))
+      out = copt_arg(&opt);
+    else if (copt_opt(&opt, "c|color"))
+      color = copt_oarg(&opt);
+    else if (copt_opt(&opt, "l|level"))
+      level = (int) copt_arg_long(&opt);
+    else if (copt_opt(&opt, "define"))
+      define = copt_arg(&opt);
+    else if (copt_opt(&opt, "j"))
+      jobs = copt_arg(&opt);
+    else
+      bad = copt_curopt(&opt);
+  }
+  test_check(__LINE__, i == 7 && verbose == 1 && out && !strcmp(out, "a b")
+             && color && !strcmp(color, "") && level == 3 && define &&
+             !strcmp(define, "X=1") && jobs && !strcmp(jobs, "4") && bad &&
+             !strcmp(bad, "=x"), "copt_init_config() parsed %d entries", i);
+  opt = copt_init_config(n, outv);   /* arg never taken from next entry */
+  copt_set_noargfn(&opt, noarg_handler, NULL);
+  assert(copt_next(&opt));
+  test_check(__LINE__, copt_arg(&opt) == NULL,
+             "copt_arg() took an arg from the next config entry");
+  test_check(__LINE__, copt_next(&opt) && copt_opt(&opt, "out"),
+             "copt_next() skipped a config entry after copt_arg()");
+  copt_unmap(&map, 1);
+
+  n = copt_config(RSP(4), &map, outv, 4);
+  test_check(__LINE__, n == 8 && !strcmp(outv[3], expect[3]),
+             "copt_config() returned %d with a small outv", n);
+  copt_unmap(&map, 1);
+  test_check(__LINE__, copt_config("nonexistent.conf", &map, outv, 10) == -1,
+             "copt_config() didn't fail on a nonexistent file");
+  remove(RSP(4));
+}
+#endif /* COPT_HAVE_MMAP */
+
+#ifdef TEST_HAVE_SETENV
+/* Prepend args from an environment variable (needs POSIX setenv()). */
+static void
+run_env_tests(void)
+{
+  static char *argv[] = {(char *) "copt", (char *) "-y", (char *) "file"};
+  static const char *const expect[] = {
+    "copt", "-x", "two words", "--z=1", "-y", "file", NULL
+  };
+  char buf[32], *outv[8];
+  int i, outc;
+  struct copt opt;
+
+  setenv("COPT_TEST_OPTS", " -x 'two words'\t--z=1 ", 1);
+  outc = copt_env("COPT_TEST_OPTS", 3, argv, buf, sizeof buf, outv, 8);
+  for (i = 0; i < outc && expect[i]; i++)
+    if (strcmp(outv[i], expect[i]))
+      break;
+  test_check(__LINE__, outc == 6 && i == 6 && outv[6] == NULL,
+             "copt_env() returned %d, mismatch at arg %d", outc, i);
+  opt = copt_init(outc, outv, 1);
+  for (i = 0; copt_next(&opt); i++)
+    test_check(__LINE__, copt_opt(&opt, i == 0 ? "x" : i == 1 ? "z" : "y"),
+               "option %d from copt_env() was %s", i, copt_curopt(&opt));
+  test_check(__LINE__, i == 3 && copt_idx(&opt) < outc &&
+             !strcmp(outv[copt_idx(&opt)], "two words"),
+             "copt_env() args gave %d options", i);
+
+  test_check(__LINE__, copt_env("COPT_TEST_OPTS", 3, argv, buf, 20, outv, 8)
+             == -1, "copt_env() didn't fail with a small buf");
+  test_check(__LINE__, copt_env("COPT_TEST_OPTS", 3, argv, buf, 32, outv, 6)
+             == -1, "copt_env() didn't fail with a small outv");
+  test_check(__LINE__, copt_env("COPT_TEST_OPTS", 0, argv, buf, 32, outv, 3)
+             == -1, "copt_env() didn't fail with a small outv and no argv");
+  test_check(__LINE__, copt_env("COPT_TEST_OPTS", 0, argv, buf, 32, outv, 4)
+             == 3, "copt_env() with no argv didn't return 3");
+  unsetenv("COPT_TEST_OPTS");
+  test_check(__LINE__, copt_env("COPT_TEST_OPTS", 3, argv, buf, 1, outv, 4)
+             == 3 && outv[1] == argv[1] && outv[3] == NULL,
+             "copt_env() with unset variable didn't copy argv as is");
+}
+#endif /* TEST_HAVE_SETENV */
+
 int
-main(void)
+main(int argc, char *argv[])
 {
+  struct copt opt = copt_init(argc, argv, 1);
   size_t i;
+  while (copt_next(&opt)) {
+    if (copt_opt(&opt, "v|verbose")) {
+      test_verbose = 1;
+    } else {
+      fprintf(stderr, "usage: %s [-v|--verbose]\n", COPT_BASENAME(argv[0]));
+      return 2;
+    }
+  }
   run_copt_tests(0);
   run_copt_tests(1);
+  run_copt_tests(2); /* reorder using scratch array */
+  run_copt_tests(3); /* reorder without modifying argv */
+  run_tab_tests();
+  run_prefix_tests();
+  run_suggest_tests();
+  run_const_tests();
+  run_batch_tests();
+  run_split_tests();
+  run_bind_tests();
+  run_num_tests();
+  run_subcmd_tests();
+  run_nonoptfn_tests();
+  run_complete_tests();
+#ifdef COPT_STATS
+  run_stats_tests();
+  run_scale_tests();
+#endif
+#ifdef COPT_HAVE_MMAP
+  run_expand_tests();
+  run_stream_tests();
+  run_config_tests();
+#endif
+#ifdef TEST_HAVE_SETENV
+  run_env_tests();
+#endif
   fflush(NULL);
 
   if (failed_test_cnt == 0)
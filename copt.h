@@ -36,25 +36,134 @@
    ...etc... */
 #ifndef COPT_H_INCLUDED_
 #define COPT_H_INCLUDED_
+#include <stddef.h>
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#if !defined(COPT_NO_MMAP) && (defined(__unix__) || defined(__unix) || \
+                                (defined(__APPLE__) && defined(__MACH__)))
+# define COPT_HAVE_MMAP 1 /* copt_expand() can map response files */
+#endif
+
 struct copt;
 typedef char *copt_errfn(const struct copt *, void *);
+typedef void copt_argfn(const struct copt *, char *arg, void *);
+
+/* Memory-mapped response file backing args from copt_expand(). */
+struct copt_map {
+  char *addr;           /* NULL if unused */
+  unsigned long len;
+};
+
+/* State for args read from a file descriptor.  Do not access fields
+   directly. */
+struct copt_stream {
+  char *win[4];         /* argv window: argv[0], current arg, next arg */
+  char *buf, *lim;      /* caller's buffer */
+  char *beg;            /* start of oldest arg still in use */
+  char *scan;           /* start of next unread arg */
+  char *chk;            /* where to resume looking for scan's '\0' */
+  char *end;            /* end of bytes read so far */
+  int fd;
+  int eof;
+  int err;              /* 1 if arg too long, -1 on read error */
+  int taken;            /* true if copt_stream_arg() returned argv[idx] */
+};
+
+/* Hash table slot for long option names in a struct copt_tab. */
+struct copt_slot {
+  const char *name;     /* NULL if slot is unused */
+  int len;              /* length of name, which isn't nul-terminated */
+  int id;               /* index of optspec containing name */
+};
+
+/* Trie node for long option name prefixes in a struct copt_tab. */
+struct copt_node {
+  int child;            /* index of first child node, or 0 if none */
+  int sibling;          /* index of next node with same parent, or 0 */
+  int id;               /* optspec id of all names below, or COPT_AMBIGUOUS */
+  unsigned char ch;     /* name byte leading to this node from its parent */
+};
+
+/* Precompiled set of optspecs.  Do not access fields directly. */
+struct copt_tab {
+  struct copt_slot *slots;
+  int nslot;
+  struct copt_node *nodes; /* prefix trie, or NULL if not matching prefixes */
+  int shortid[256];     /* 1 + index of optspec for each short option */
+};
+
+/* copt_id() result for a --long option abbreviating several optspecs. */
+#define COPT_AMBIGUOUS (-2)
+
+/* Kinds of args an optspec takes, for copt_parse_batch(). */
+#define COPT_ARG_NONE     0
+#define COPT_ARG_REQUIRED 1 /* like copt_arg() */
+#define COPT_ARG_OPTIONAL 2 /* like copt_oarg() */
+
+/* Kinds of destinations for copt_bind(). */
+#define COPT_BIND_FLAG  0 /* int set to 1 */
+#define COPT_BIND_COUNT 1 /* int incremented each time, e.g. for -vvv */
+#define COPT_BIND_STR   2 /* char * set to copt_arg() */
+#define COPT_BIND_OSTR  3 /* char * set to copt_oarg(), which may be NULL */
+#define COPT_BIND_INT   4 /* int parsed from copt_arg() */
+#define COPT_BIND_LONG  5 /* long parsed from copt_arg() */
+
+/* Optspec bound to a destination variable, for copt_bind(). */
+struct copt_bind {
+  const char *spec;     /* optspec, e.g. "o|outfile" */
+  int kind;             /* COPT_BIND_* */
+  void *dst;            /* variable of the type kind says */
+};
+
+/* copt_rec id for a non-option arg. */
+#define COPT_NONOPT (-3)
+
+/* One parsed item of a command line from copt_parse_batch(). */
+struct copt_rec {
+  int id;               /* optspec index, -1, COPT_AMBIGUOUS or COPT_NONOPT */
+  char *arg;            /* option's arg, whole arg if unknown, or non-opt */
+};
+
+/* Hot path counters for one copt context, from copt_stats().  Only
+   counted if COPT_STATS is defined (everywhere copt.h is included). */
+struct copt_stats {
+  unsigned long args;      /* argv items examined by copt_next() */
+  unsigned long specs;     /* optspec names compared by copt_opt() */
+  unsigned long bytes;     /* optspec bytes read by copt_opt() */
+  unsigned long rotations; /* calls to copt_rotate_right() */
+  unsigned long moved;     /* bytes of argv moved or copied to reorder */
+  unsigned long scans;     /* args skipped looking for next option */
+};
 
 /* Option parser's state.  Do not access fields directly. */
 struct copt {
   char *curopt;
+  char *name;           /* current opt's name without dashes, or NULL */
+  int namelen;          /* length of name, which may be followed by "=ARG" */
   char **argv;
   int argc;
   int idx;              /* current index into argv */
   int subidx;           /* > 0 if in grouped short opts */
   int argidx;           /* index of opt's (potential) arg if reordering */
+  int next;             /* next unscanned index if using scratch */
+  char **scratch;       /* caller's storage for skipped non-options */
+  int nscratch;         /* number of non-options parked in scratch */
+  struct copt_stream *stream; /* if reading args from file descriptor */
   copt_errfn *noargfn;  /* called on missing option arg */
   void *noarg_aux;      /* passed to callback */
+  copt_errfn *badargfn; /* called on non-numeric or out of range arg */
+  void *badarg_aux;     /* passed to callback */
+  copt_argfn *nonoptfn; /* called on each non-option as it's met */
+  void *nonopt_aux;     /* passed to callback */
   char shortopt[3];     /* to get last short opt even if grouped */
   unsigned reorder:1;   /* true if allowing opts mixed with non-opts */
+  unsigned readonly:1;  /* true if from copt_init_const() */
+  unsigned config:1;    /* true if from copt_init_config() */
+#ifdef COPT_STATS
+  struct copt_stats stats;
+#endif
 };
 
 /* Return a copt context initialized to parse ARGC items from argument list
@@ -63,6 +172,92 @@ struct copt {
    the first non-option arg in ARGV. */
 struct copt copt_init(int argc, char **argv, int reorder);
 
+/* Return a copt context that parses ARGC items from ARGV like copt_init()
+   with REORDER true, but without modifying ARGV, so ARGV can be read-only
+   or shared between threads.  Non-option args are collected in order in
+   caller-provided array NONOPTS of CNT items instead; get them with
+   copt_nonopt_count() and copt_nonopt_at() once copt_next() returns false.
+   If CNT is less than ARGC, options can't be mixed with non-option args,
+   as with REORDER false.  Strings from copt_arg(), etc. point into ARGV
+   and must not be modified. */
+struct copt copt_init_const(int argc, const char *const *argv,
+                            const char **nonopts, int cnt);
+
+/* After copt_next() returns false, return the number of non-option args.
+   Works for any copt context, not just those from copt_init_const(). */
+int copt_nonopt_count(const struct copt *);
+
+/* After copt_next() returns false, return the non-option arg at index I,
+   from 0 to copt_nonopt_count()-1. */
+const char *copt_nonopt_at(const struct copt *, int i);
+
+/* Parse NLINE command lines against precompiled optspecs TAB, e.g. many
+   job command lines in a server.  ARGVS[i] is the i'th NULL-terminated
+   argv, and KINDS[j] is the COPT_ARG_* kind of TAB's j'th optspec.  Each
+   line is parsed like copt_init_const() using caller-provided array
+   NONOPTS of NNONOPT items, so argvs are never modified, and options are
+   only mixed with non-options in lines with at most NNONOPT args.
+
+   Each line's options go in caller-provided array RECS of NREC items, in
+   order, followed by its non-options.  Records for line i are RECS[j] for
+   ENDS[i-1] <= j < ENDS[i] (from 0 for line 0).  An option's arg is NULL
+   if it has none, including when a required arg is missing.
+
+   TAB and KINDS are only read, so threads can share them with no locks as
+   long as each thread has its own NONOPTS, RECS and ENDS.  Return the
+   number of lines parsed, which is less than NLINE if RECS filled up. */
+int copt_parse_batch(const struct copt_tab *tab, const unsigned char *kinds,
+                     int nline, char *const *const *argvs,
+                     const char **nonopts, int nnonopt,
+                     struct copt_rec *recs, int nrec, int *ends);
+
+/* Compile the optspecs of NBIND items in BINDS into TAB for copt_bind(),
+   the same way copt_tab_init() does, using caller-provided array SLOTS of
+   NSLOT items.  Build TAB once, and reuse it for every copt_bind() call
+   with the same BINDS.  Return 0 on success, or -1 if SLOTS is too small. */
+int copt_tab_bind(struct copt_tab *tab, const struct copt_bind *binds,
+                  int nbind, struct copt_slot *slots, int nslot);
+
+/* Parse all options from OPT in one pass, storing each one's value
+   straight into the destination of the first item in BINDS it matches,
+   instead of writing an if/else chain of copt_opt() calls.  TAB must come
+   from copt_tab_bind() on the same BINDS.  Integers are read like
+   copt_arg_long() reads them, so an arg that isn't a decimal integer of
+   the right size goes to the function given to copt_set_badargfn(), and
+   the destination is set to 0 if what that returns isn't valid either.
+
+   Return 0 once all options are parsed.  Stop early and return 1 at an
+   unknown option.  copt_curopt() then gives the option, and calling
+   copt_bind() again resumes after it. */
+int copt_bind(struct copt *opt, const struct copt_bind *binds,
+              const struct copt_tab *tab);
+
+/* Return a copt context that reads args from file descriptor FD as a
+   stream of nul-terminated strings (e.g. from `find -print0`), as if they
+   followed program name ARGV0 in an argv array.  Args are read into
+   caller-provided buffer BUF of CAP bytes, which is reused as parsing goes
+   on, so memory use doesn't grow with the number of args.  BUF must fit
+   any two adjacent args with their nul terminators.  ST holds the stream's
+   state, and must stay in scope while the returned context is used.
+
+   Use the returned context like any other, except that options can't be
+   mixed with non-options, copt_idx() is meaningless, and strings from
+   copt_curopt()/copt_arg()/copt_oarg() are only valid until the next
+   copt_next() call.  After copt_next() returns false, read non-option args
+   with copt_stream_arg(). */
+struct copt copt_init_fd(char *argv0, int fd, struct copt_stream *st,
+                         char *buf, unsigned long cap);
+
+/* After copt_next() returns false on a copt context from copt_init_fd(),
+   return the next non-option arg in the stream, or NULL if none remain.
+   The returned string is only valid until the next call. */
+char *copt_stream_arg(struct copt *);
+
+/* Return 0 if no error occurred reading stream ST, 1 if an arg didn't fit
+   in the buffer given to copt_init_fd(), or -1 if reading failed (in which
+   case errno says why).  When an error occurs, the stream ends early. */
+int copt_stream_err(const struct copt_stream *st);
+
 /* Advance to next option.  Return true while options remain in the arg
    array passed to copt_init().  Return false when all options have been
    consumed, after which you'd call copt_idx() to get non-option args. */
@@ -75,6 +270,92 @@ int copt_next(struct copt *);
    "-F", "-f", or "--foo", accounting for grouped short options. */
 int copt_opt(const struct copt *, const char *optspec);
 
+/* Compile NSPEC optspecs in array SPECS into TAB so copt_id() can match
+   options in constant time, no matter how many optspecs there are.  Long
+   option names go in a hash table stored in caller-provided array SLOTS of
+   NSLOT items, which should be about twice the number of long names for
+   best speed.  SPECS must stay valid while TAB is in use.  Return 0 on
+   success, or -1 if SLOTS doesn't have enough room. */
+int copt_tab_init(struct copt_tab *tab, const char *const *specs, int nspec,
+                  struct copt_slot *slots, int nslot);
+
+/* After copt_next() indicates more options remain, call this function to
+   get the index of the first optspec in TAB matching the current option,
+   or -1 if none match.  Same as calling copt_opt() on each optspec given
+   to copt_tab_init() in order, but you can switch() on the result. */
+int copt_id(const struct copt *, const struct copt_tab *tab);
+
+/* Make copt_id() on TAB also accept unique prefixes of long option names,
+   like getopt_long(), e.g. "--out" for "o|outfile".  Exact names still win
+   over prefixes, and copt_id() returns COPT_AMBIGUOUS if a prefix belongs
+   to more than one optspec.  Builds a trie of long names in caller-provided
+   array NODES of NNODE items, which needs one more item than the total
+   length of all long names in TAB at most.  Matching takes time linear in
+   the option's length no matter how many optspecs there are.  Call after
+   copt_tab_init().  Return 0 on success, or -1 if NODES is too small. */
+int copt_tab_prefix(struct copt_tab *tab, struct copt_node *nodes,
+                    int nnode);
+
+/* After copt_next() returns false for OPT, look up the subcommand at
+   copt_idx() in TAB, which was compiled with copt_tab_init() from
+   subcommand names, each an optspec of aliases like "commit|ci".  Return
+   the subcommand's index in TAB, or -1 if it's not in TAB or there is no
+   subcommand (compare copt_idx() to ARGC to tell which).
+
+   Either way, init *SUB like copt_init() with REORDER over the subcommand
+   and the args after it in OPT's argv, without copying them.  SUB's argv[0]
+   is the subcommand, so copt_next() skips it like a program name, and SUB
+   calls the same noargfn and badargfn as OPT.  SUB has no nonoptfn; give
+   it one with copt_set_nonoptfn() if needed.  OPT should be from
+   copt_init() with REORDER false, so options before the subcommand are
+   global options, and SUB can check its unknown options against the
+   global optspecs with copt_opt() to also allow global options after the
+   subcommand. */
+int copt_subcmd(const struct copt *opt, const struct copt_tab *tab,
+                int reorder, struct copt *sub);
+
+/* After copt_next() finds an unknown --long option, call this function to
+   get the option names in NSPEC optspecs SPECS closest to it, e.g. to ask
+   "did you mean --outfile?".  Stores up to NOUT of the names with the
+   smallest Levenshtein distance, if at most MAXDIST, in caller-provided
+   array OUT, with each name pointing into SPECS (not nul-terminated) and
+   id set to its optspec's index.  Return the number of names stored.
+   Returns 0 for short options, and for --long options longer than the
+   number of bits in an unsigned long. */
+int copt_suggest(const struct copt *opt, const char *const *specs, int nspec,
+                 int maxdist, struct copt_slot *out, int nout);
+
+/* Store every name in NSPEC optspecs SPECS in caller-provided array NAMES
+   of NNAME items, sorted for copt_complete(): short names first, then long
+   names in byte order.  A name in several optspecs is stored once, with
+   the first one's index as its id.  Names point into SPECS, which must
+   stay valid while NAMES is in use.  Return the number of names stored,
+   or -1 if NAMES is too small.  copt-gen can generate this table ahead of
+   time, so completion doesn't need to sort on every keypress. */
+int copt_names_init(const char *const *specs, int nspec,
+                    struct copt_slot *names, int nname);
+
+/* copt_complete() result when the word is an option's argument. */
+#define COPT_COMPLETE_ARG (-1)
+
+/* Complete the last of ARGC words in ARGV for shell tab completion, e.g.
+   with bash's COMP_WORDS[0..COMP_CWORD], from NNAME NAMES made by
+   copt_names_init().  KINDS[j] is the COPT_ARG_* kind of optspec j.  The
+   words before it are parsed like copt_init() with REORDER true would,
+   without modifying ARGV, using binary searches of NAMES instead of a
+   copt_opt() chain, so call this before any slow initialization.
+
+   Return the number of names the word could complete to, which are NAMES
+   from index *AT onward: all names for "-", or long names starting with
+   PREFIX for "--PREFIX".  Print a short name X as "-X" and a long name
+   NAME as "--NAME".  Return 0 for non-options and groups of short
+   options.  If the word is instead the argument of an option, as in
+   "--outfile=F", "-oF", or "F" after "-o", return COPT_COMPLETE_ARG and
+   set *AT to the option's optspec index, e.g. to complete file names. */
+int copt_complete(const struct copt_slot *names, int nname,
+                  const unsigned char *kinds, int argc, char **argv,
+                  int *at);
+
 /* After copt_opt() indicates you found an option, call this function if
    your option expects an argument.  Returns the arg given to the option
    matched by the last call to copt_opt(). */
@@ -85,6 +366,19 @@ char *copt_arg(struct copt *);
    matched by the last call to copt_opt(), or NULL if no arg exists. */
 char *copt_oarg(struct copt *);
 
+/* Same as copt_arg(), but convert the arg to a number.  Integers must be
+   decimal, with an optional sign for copt_arg_long() only, and are read
+   without strtol() so they don't depend on the locale.  copt_arg_size()
+   also accepts a suffix K, M or G (powers of 1000) or Ki, Mi or Gi (powers
+   of 1024), e.g. "4Ki" is 4096.  copt_arg_double() uses strtod().  If the
+   arg isn't a number or is out of range, return the conversion of what
+   the function given to copt_set_badargfn() returns, or 0 if that fails
+   too.  Return 0 if copt_arg() returns NULL. */
+long copt_arg_long(struct copt *);
+unsigned long copt_arg_ulong(struct copt *);
+double copt_arg_double(struct copt *);
+size_t copt_arg_size(struct copt *);
+
 /* Return the option found by most recent call to copt_next().  To meet
    copt's goal of zero heap allocation, the returned string is valid _only_
    until the next call on the given copt object, and _only_ while the given
@@ -105,6 +399,102 @@ int copt_idx(const struct copt *);
    option, then it will return NOARGFN's return value. */
 void copt_set_noargfn(struct copt *opt, copt_errfn *noargfn, void *aux);
 
+/* Make copt context OPT call BADARGFN with the given AUX when an arg given
+   to copt_arg_long() and friends isn't a valid number, e.g. to print an
+   error or return a default.  By default, copt prints an error and exits,
+   like it does for a missing arg. */
+void copt_set_badargfn(struct copt *opt, copt_errfn *badargfn, void *aux);
+
+/* Make copt context OPT call NONOPTFN with each non-option arg and the
+   given AUX as soon as copt_next() reaches it, then move on to the next
+   option, so you can start on inputs (e.g. open files) while parsing.
+   Args after "--" are all passed to NONOPTFN before copt_next() returns
+   false.  Each arg is looked at once and ARGV is never reordered, so
+   this turns off reordering and copt_set_scratch().  For copt_init_fd(),
+   ARG is only valid during the call.  Call before first copt_next(). */
+void copt_set_nonoptfn(struct copt *opt, copt_argfn *nonoptfn, void *aux);
+
+/* Let reordering copt context OPT park skipped non-option args in
+   caller-provided array SCRATCH of CNT items instead of shifting them
+   through ARGV on every option.  This makes reordering O(ARGC) overall
+   rather than O(options * non-options), with the same end result.  CNT
+   must be at least the ARGC given to copt_init(), and SCRATCH must stay
+   valid until copt_next() returns false.  Call before first copt_next().
+   Has no effect if OPT isn't reordering or if SCRATCH is too small. */
+void copt_set_scratch(struct copt *opt, char **scratch, int cnt);
+
+/* Copy ARGC items from ARGV into caller-provided array OUTV of OUTCAP
+   items, replacing each "@FILE" arg with the args in response file FILE.
+   Args in FILE are split on whitespace, and can use single quotes, double
+   quotes, and backslashes as in a POSIX shell: everything inside '...' is
+   literal, and inside "..." a backslash only escapes \\, \", $, ` and
+   newline.  Nested "@FILE" args in FILE are also expanded.  An "@FILE"
+   arg is kept as-is if FILE can't be opened.
+
+   No args are copied: each FILE is memory-mapped into an item of array
+   MAPS (of NMAP items), split in place, and args in OUTV point into the
+   mapping.  Call copt_unmap() once you're done with those args.
+
+   Return the number of args after expansion, or -1 if more than NMAP
+   files are needed.  If the return value is less than OUTCAP, OUTV holds
+   all args plus a NULL terminator and is ready to pass to copt_init().
+   Otherwise OUTV was too small; call copt_unmap() and try again with a
+   bigger one.  Without COPT_HAVE_MMAP, "@FILE" args are never expanded. */
+int copt_expand(int argc, char **argv, char **outv, int outcap,
+                struct copt_map *maps, int nmap);
+
+/* Unmap the NMAP files in MAPS mapped by copt_expand(). */
+void copt_unmap(struct copt_map *maps, int nmap);
+
+/* Memory-map config file PATH into *MAP and store its entries in
+   caller-provided array OUTV of OUTCAP items, after PATH itself, for
+   copt_init_config().  Each line is "KEY VALUE", "KEY = VALUE" or just
+   "KEY", and becomes entry "KEY=VALUE" or "KEY", rewritten in place in
+   the mapping so entries point into it rather than being copied.  VALUE
+   is the rest of the line with surrounding blanks removed, and taken as
+   is, without quotes or escapes.  Blank lines and lines starting with '#'
+   are skipped.  Return the number of items, or -1 if PATH can't be
+   mapped.  If the return value is less than OUTCAP, OUTV holds all items
+   plus a NULL terminator.  Otherwise call copt_unmap() on MAP and try
+   again with a bigger OUTV.  Always returns -1 without COPT_HAVE_MMAP. */
+int copt_config(const char *path, struct copt_map *map, char **outv,
+                int outcap);
+
+/* Return a copt context that parses ARGC config entries in ARGV, from
+   copt_config(), as if each were a --long option: entry "KEY=VALUE" is
+   treated as "--KEY=VALUE", so config files and command lines can share
+   the same copt_opt() branches.  copt_arg() only gets an entry's own
+   VALUE, never the next entry.  ARGV[0] is skipped like a program name,
+   and is used as such in error messages. */
+struct copt copt_init_config(int argc, char **argv);
+
+/* Split nul-terminated string BUF into args in place, the same way
+   copt_expand() splits response files, e.g. for command strings read from
+   a socket.  Store the args plus a NULL terminator in caller-provided
+   array ARGV of CAP items, ready to pass to copt_init(), which skips the
+   first arg like a program name.  Nothing is allocated or copied: args
+   point into BUF, and quotes and backslashes are removed by shifting BUF's
+   bytes down.  Return the number of args, or -1 if ARGV is too small, in
+   which case BUF is only partly split. */
+int copt_split(char *buf, char **argv, int cap);
+
+/* Prepend args from environment variable VAR to ARGC items in ARGV, like
+   GZIP or LESS do, e.g. VAR="MYTOOL_OPTS".  Copy VAR's value into
+   caller-provided buffer BUF of BUFSIZE bytes and split it in place like
+   copt_split().  Store ARGV[0], VAR's args, the rest of ARGV, and a NULL
+   terminator in caller-provided array OUTV of OUTCAP items, ready to pass
+   to copt_init(), so one copt_next() loop sees VAR's args as if given
+   first.  OUTV gets copies of ARGV's pointers, not of its strings, so it
+   needs ARGC + N + 1 items for N args in VAR, or N + 1 if ARGC is 0.  An
+   unset VAR adds no args.  Return the number of args in OUTV, or -1 if
+   BUF or OUTV is too small. */
+int copt_env(const char *var, int argc, char **argv, char *buf, int bufsize,
+             char **outv, int outcap);
+
+/* Return hot path counters for copt context OPT.  All zero unless copt.h
+   was compiled with COPT_STATS defined. */
+struct copt_stats copt_stats(const struct copt *opt);
+
 /* Return last component of path S, using dir seperators '/' and '\\'. */
 #define COPT_BASENAME(s)    (COPT_BASENAME_(COPT_BASENAME_((s),'/'), '\\'))
 #define COPT_BASENAME_(s,c) (strrchr((s),(c)) ? strrchr((s),(c)) + 1 : (s))
@@ -121,24 +511,73 @@ void copt_set_noargfn(struct copt *opt, copt_errfn *noargfn, void *aux);
 # define _CRT_SECURE_NO_WARNINGS 1 /* proprietary MS stuff */
 #endif
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef COPT_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define COPT_READ_(fd, buf, n) read((fd), (buf), (n))
+#if defined(MAP_ANONYMOUS)
+# define COPT_MAP_ANON_ MAP_ANONYMOUS
+# define COPT_ZERO_FD_  (-1)
+#elif defined(MAP_ANON)
+# define COPT_MAP_ANON_ MAP_ANON
+# define COPT_ZERO_FD_  (-1)
+#else /* e.g. strict POSIX mode, so map /dev/zero instead */
+# define COPT_MAP_ANON_ 0
+# define COPT_ZERO_FD_  open("/dev/zero", O_RDWR)
+#endif
+#elif defined(_WIN32)
+#include <io.h>
+#define COPT_READ_(fd, buf, n) _read((fd), (buf), (unsigned) (n))
+#else
+#define COPT_READ_(fd, buf, n) (-1) /* no file descriptors */
+#endif
+
+/* Add N to counter FIELD of OPT's stats.  Casts away const so copt_opt()
+   can count too; copt contexts are never actually const objects. */
+#ifdef COPT_STATS
+# define COPT_COUNT_(opt, field, n) \
+  ((void) (((struct copt *) (opt))->stats.field += (n)))
+#else
+# define COPT_COUNT_(opt, field, n) ((void) 0)
+#endif
 
 struct copt
 copt_init(int argc, char **argv, int reorder)
 {
   struct copt opt;
   opt.curopt = NULL;
+  opt.name = NULL;
+  opt.namelen = 0;
   opt.argc = argc;
   opt.argv = argv;
   opt.idx = 0;
   opt.subidx = 0;
   opt.argidx = 0;
+  opt.next = 1;
+  opt.scratch = NULL;
+  opt.nscratch = 0;
+  opt.stream = NULL;
   opt.noargfn = NULL;
   opt.noarg_aux = NULL;
+  opt.badargfn = NULL;
+  opt.badarg_aux = NULL;
+  opt.nonoptfn = NULL;
+  opt.nonopt_aux = NULL;
   opt.shortopt[0] = '\0';
   opt.reorder = !!reorder;
+  opt.readonly = 0;
+  opt.config = 0;
+#ifdef COPT_STATS
+  memset(&opt.stats, 0, sizeof opt.stats);
+#endif
   return opt;
 }
 
@@ -151,41 +590,222 @@ copt_set_shortopt(struct copt *opt, char c)
   return c == '\0' ? NULL : opt->shortopt;
 }
 
-/* Rotate ARGC items in array ARGV one index to the right. */
+/* Rotate N items of OPT's argv starting at index I one index to the
+   right. */
 static void
-copt_rotate_right(char **argv, size_t argc)
+copt_rotate_right(struct copt *opt, int i, size_t n)
 {
+  char **argv = opt->argv + i;
   char *arg;
-  assert(argc > 0);
-  arg = argv[argc-1];
-  memmove(argv+1, argv, (argc-1) * sizeof *argv);
+  assert(n > 0);
+  COPT_COUNT_(opt, rotations, 1);
+  COPT_COUNT_(opt, moved, (n-1) * sizeof *argv);
+  arg = argv[n-1];
+  memmove(argv+1, argv, (n-1) * sizeof *argv);
   *argv = arg;
 }
 
+/* Move non-options parked in scratch back into ARGV starting at DST. */
+static void
+copt_unpark(struct copt *opt, int dst)
+{
+  assert(dst + opt->nscratch <= opt->argc);
+  COPT_COUNT_(opt, moved, opt->nscratch * sizeof *opt->argv);
+  memcpy(opt->argv + dst, opt->scratch, opt->nscratch * sizeof *opt->argv);
+  opt->nscratch = 0;
+}
+
+/* Same as copt_reorder_opt(), but rather than rotating each option past
+   all non-options seen so far, park non-options in opt->scratch and copy
+   them back once no options remain.  Slots [idx, next) of argv are free
+   while non-options are parked, so next == idx + nscratch on entry. */
+static void
+copt_reorder_scratch(struct copt *opt)
+{
+  char **argv = opt->argv;
+  int i;
+  assert(opt->next == opt->idx + opt->nscratch);
+  for (i = opt->next; i < opt->argc; i++)
+    if (argv[i][0] == '-' && argv[i][1] != '\0')
+      break;
+  COPT_COUNT_(opt, scans, i - opt->next);
+  if (i >= opt->argc) {               /* no options left */
+    copt_unpark(opt, opt->idx);
+    return;
+  }
+  COPT_COUNT_(opt, moved, (i - opt->next + 1) * sizeof *argv);
+  memcpy(opt->scratch + opt->nscratch, argv + opt->next,
+         (i - opt->next) * sizeof *argv);
+  opt->nscratch += i - opt->next;
+  argv[opt->idx] = argv[i];
+  opt->next = ++i;
+  if (!strcmp(argv[opt->idx], "--"))  /* non-options go after "--" */
+    copt_unpark(opt, opt->idx + 1);
+  else if (i >= opt->argc || argv[i][0] != '-' || argv[i][1] == '\0')
+    opt->argidx = i;
+  else
+    opt->argidx = opt->argc;
+}
+
 static void
 copt_reorder_opt(struct copt *opt)
 {
   char **argv = opt->argv;
   int i;
   opt->argidx = 0;
+  if (opt->scratch) {
+    copt_reorder_scratch(opt);
+    return;
+  }
   for (i = opt->idx; i < opt->argc; i++)
     if (argv[i][0] == '-' && argv[i][1] != '\0')
       break;
+  COPT_COUNT_(opt, scans, i - opt->idx);
   if (i >= opt->argc || argv[i][0] != '-' || argv[i][1] == '\0')
     return;
   i++;
-  copt_rotate_right(opt->argv + opt->idx, i - opt->idx);
+  copt_rotate_right(opt, opt->idx, i - opt->idx);
   if (i >= opt->argc || opt->argv[i][0] != '-' || opt->argv[i][1] == '\0')
     opt->argidx = i;
   else
     opt->argidx = opt->argc;
 }
 
+/* Return next nul-terminated arg read from OPT's stream, or NULL at end
+   of stream or on error.  Shifts unused bytes to the start of the buffer
+   when it fills up, adjusting argv window pointers to match. */
+static char *
+copt_stream_read(struct copt *opt)
+{
+  struct copt_stream *st = opt->stream;
+  char *nul, *arg;
+  long n;
+  int i;
+  for (;;) {
+    if ((nul = (char *) memchr(st->chk, '\0', st->end - st->chk)) != NULL) {
+      arg = st->scan;
+      st->scan = st->chk = nul+1;
+      return arg;
+    }
+    st->chk = st->end;
+    if (st->end == st->lim) {   /* buffer full */
+      if (st->beg == st->buf)
+        return st->err = 1, (char *) NULL;
+      n = st->beg - st->buf;
+      memmove(st->buf, st->beg, st->end - st->beg);
+      for (i = 1; i < opt->argc; i++)
+        opt->argv[i] -= n;
+      st->beg -= n, st->scan -= n, st->chk -= n, st->end -= n;
+    } else if (st->eof) {       /* last arg may lack '\0' */
+      if (st->scan == st->end)
+        return NULL;
+      *st->end++ = '\0';
+    } else if ((n = COPT_READ_(st->fd, st->end, st->lim - st->end)) > 0) {
+      st->end += n;
+    } else if (n == 0) {
+      st->eof = 1;
+    } else {
+      return st->err = -1, st->eof = 1, (char *) NULL;
+    }
+  }
+}
+
+/* Drop stream args before opt->idx from OPT's argv window, then fill the
+   window with the current arg plus one more for copt_arg().  Return the
+   new opt->idx. */
+static int
+copt_stream_shift(struct copt *opt)
+{
+  struct copt_stream *st = opt->stream;
+  char *arg;
+  int i;
+  if (opt->idx > 1) {
+    for (i = 1; i + opt->idx - 1 < opt->argc; i++)
+      opt->argv[i] = opt->argv[i + opt->idx - 1];
+    opt->argc = i;
+    opt->idx = 1;
+    st->beg = opt->argc > 1 ? opt->argv[1] : st->scan;
+  }
+  while (opt->argc < 3 && !st->err && (arg = copt_stream_read(opt)))
+    opt->argv[opt->argc++] = arg;
+  opt->argv[opt->argc] = NULL;
+  return opt->idx;
+}
+
+struct copt
+copt_init_fd(char *argv0, int fd, struct copt_stream *st,
+             char *buf, unsigned long cap)
+{
+  struct copt opt = copt_init(1, st->win, 0);
+  st->win[0] = argv0;
+  st->win[1] = NULL;
+  st->buf = st->beg = st->scan = st->chk = st->end = buf;
+  st->lim = buf + cap;
+  st->fd = fd;
+  st->eof = st->err = st->taken = 0;
+  opt.stream = st;
+  return opt;
+}
+
+char *
+copt_stream_arg(struct copt *opt)
+{
+  struct copt_stream *st = opt->stream;
+  assert(st != NULL);
+  opt->idx += st->taken;
+  copt_stream_shift(opt);
+  st->taken = opt->idx < opt->argc;
+  return st->taken ? opt->argv[opt->idx] : NULL;
+}
+
+int copt_stream_err(const struct copt_stream *st) { return st->err; }
+
+/* Record name and name length of option at argv[opt->idx] so copt_opt(),
+   copt_id() and copt_arg() don't have to measure it again on every call.
+   Sets opt->curopt, and returns true for copt_next(). */
+static int
+copt_set_name(struct copt *opt)
+{
+  char *arg = opt->argv[opt->idx];
+  if (opt->subidx > 0) {      /* in (possibly grouped) short option */
+    opt->name = arg + opt->subidx;
+    opt->namelen = *opt->name != '=';  /* "-=" is an empty name */
+    opt->curopt = copt_set_shortopt(opt, *opt->name);
+  } else {                    /* in --long option, maybe with "=ARG" */
+    opt->name = arg + (opt->config ? 0 : 2);
+    opt->namelen = (int) strcspn(opt->name, "=");
+    opt->curopt = arg;
+  }
+  return 1;
+}
+
+/* Pass OPT's non-options from argv[I] on to its nonoptfn, up to the next
+   option, or through the last arg if "--" comes first.  Return index of
+   the next option, or argc if none remain. */
+static int
+copt_pass_nonopts(struct copt *opt, int i)
+{
+  int end = 0;
+  while (i < opt->argc) {
+    if (!end && !strcmp(opt->argv[i], "--"))
+      end = 1;
+    else if (!end && opt->argv[i][0] == '-' && opt->argv[i][1] != '\0')
+      break;
+    else
+      opt->nonoptfn(opt, opt->argv[i], opt->nonopt_aux);
+    COPT_COUNT_(opt, args, 1);
+    i = ++opt->idx;
+    if (opt->stream)
+      i = copt_stream_shift(opt);
+  }
+  return i;
+}
+
 int
 copt_next(struct copt *opt)
 {
   int i = opt->idx;
-  opt->curopt = NULL;
+  opt->curopt = opt->name = NULL;
   if (opt->idx >= opt->argc)
     return 0;
   if (opt->subidx > 0) {  /* inside grouped short options */
@@ -195,16 +815,31 @@ copt_next(struct copt *opt)
     opt->subidx++;
     so = opt->argv[i][opt->subidx];
     if (so != '\0')
-      return (opt->curopt = copt_set_shortopt(opt, so)), 1;
+      return copt_set_name(opt);
     opt->subidx = 0; /* leaving short option group */
   }
   /* done with previous argv elem */
   i = ++opt->idx;
+  if (opt->stream)
+    i = copt_stream_shift(opt);
+  if (opt->nonoptfn)                /* hand over non-options as met */
+    i = copt_pass_nonopts(opt, i);
+  if (opt->readonly && opt->scratch) {  /* collect non-options in order */
+    for (; i < opt->argc && (opt->argv[i][0] != '-' ||
+                             opt->argv[i][1] == '\0'); i = ++opt->idx) {
+      COPT_COUNT_(opt, scans, 1);
+      COPT_COUNT_(opt, moved, sizeof *opt->argv);
+      opt->scratch[opt->nscratch++] = opt->argv[i];
+    }
+  }
   assert(i <= opt->argc);
   if (i >= opt->argc)
     return 0;
   if (opt->reorder)
     copt_reorder_opt(opt);
+  COPT_COUNT_(opt, args, 1);
+  if (opt->config)                  /* config entries are all options */
+    return copt_set_name(opt);
   if (!strcmp(opt->argv[i], "--"))  /* just "--" means done */
     return opt->idx++, 0;
   if (opt->argv[i][0] != '-')       /* found non-option */
@@ -213,40 +848,267 @@ copt_next(struct copt *opt)
     return 0;
   if (opt->argv[i][1] != '-') {     /* entering short option group */
     opt->subidx = 1;
-    opt->curopt = copt_set_shortopt(opt, opt->argv[i][1]);
   } else {                          /* found long option */
     assert(opt->argv[i][0] == '-' && opt->argv[i][1] == '-');
     opt->subidx = 0;
-    opt->curopt = opt->argv[i];
   }
-  return 1;
+  return copt_set_name(opt);
 }
 
 int
 copt_opt(const struct copt *opt, const char *optspec)
 {
-  char *arg = opt->argv[opt->idx];
   const char *start, *end;
-  size_t arglen;
-  assert((arg && arg[0] == '-' && arg[1] != '\0') || !!!"not option");
-
-  if (opt->subidx > 0) /* in (possibly grouped) short option */
-    arg += opt->subidx, arglen = 1;
-  else                 /* in --long option */
-    arg += 2, arglen = strlen(arg);
-  if ((end = strchr(arg, '=')) != NULL) /* --opt=ARG form */
-    arglen = arglen < (size_t) (end-arg) ? arglen : (size_t) (end-arg);
+  size_t arglen = (size_t) opt->namelen;
+  const char *arg = opt->name;
+  assert(arg != NULL || !!!"not option");
 
-  /* Search for current arg in pipe-delimited optspec. */
+  /* Search for current arg in pipe-delimited optspec, comparing as we go
+     so each optspec byte is only read once. */
   for (start = optspec; *start != '\0'; start = end + (*end != '\0')) {
-    end = strchr(start, '|');
-    end = end ? end : start + strlen(start);
-    if ((size_t) (end-start) == arglen && !memcmp(arg, start, arglen))
+    for (end = start; (size_t) (end-start) < arglen && *end == *arg &&
+                      *end != '|'; end++)
+      arg++;
+    COPT_COUNT_(opt, specs, 1);
+    if ((size_t) (end-start) == arglen && (*end == '|' || *end == '\0')) {
+      COPT_COUNT_(opt, bytes, end-start + 1);
       return 1;
+    }
+    arg = opt->name;
+    while (*end != '\0' && *end != '|')
+      end++;
+    COPT_COUNT_(opt, bytes, end-start + 1);
+  }
+  return 0;
+}
+
+/* FNV-1a hash of LEN bytes at S. */
+static unsigned long
+copt_hash(const char *s, size_t len)
+{
+  unsigned long h = 2166136261UL;
+  while (len-- > 0)
+    h = ((h ^ (unsigned char) *s++) * 16777619UL) & 0xffffffffUL;
+  return h;
+}
+
+/* Same as copt_tab_init(), but optspec i is at byte offset i*STRIDE from
+   SPECS, so it can be a field of an array of structs. */
+static int
+copt_tab_build(struct copt_tab *tab, const char *const *specs,
+               size_t stride, int nspec, struct copt_slot *slots, int nslot)
+{
+  const char *start, *end;
+  int i, used = 0;
+  tab->slots = slots;
+  tab->nslot = nslot;
+  tab->nodes = NULL;
+  memset(tab->shortid, 0, sizeof tab->shortid);
+  for (i = 0; i < nslot; i++)
+    slots[i].name = NULL;
+
+  /* Earlier optspecs take priority, just like an if/else copt_opt() chain,
+     so never overwrite names that are already in the table. */
+  for (i = 0; i < nspec; i++) {
+    start = *(const char *const *) ((const char *) specs + i*stride);
+    for (; *start != '\0'; start = end + (*end != '\0')) {
+      size_t len, h;
+      end = strchr(start, '|');
+      end = end ? end : start + strlen(start);
+      if ((len = end-start) == 1) {
+        if (!tab->shortid[(unsigned char) *start])
+          tab->shortid[(unsigned char) *start] = i+1;
+        continue;
+      }
+      if (nslot <= 0)
+        return -1;
+      h = copt_hash(start, len) % nslot;
+      while (slots[h].name && (slots[h].len != (int) len ||
+                               memcmp(slots[h].name, start, len)))
+        h = h+1 < (size_t) nslot ? h+1 : 0;
+      if (slots[h].name)
+        continue;             /* duplicate name */
+      if (++used >= nslot)
+        return -1;            /* need an empty slot to stop lookups */
+      slots[h].name = start;
+      slots[h].len = (int) len;
+      slots[h].id = i;
+    }
+  }
+  return 0;
+}
+
+int
+copt_tab_init(struct copt_tab *tab, const char *const *specs, int nspec,
+              struct copt_slot *slots, int nslot)
+{
+  return copt_tab_build(tab, specs, sizeof *specs, nspec, slots, nslot);
+}
+
+/* Return id of optspec in TAB with a long name that current option of OPT
+   abbreviates, COPT_AMBIGUOUS if several do, or -1 if none do. */
+static int
+copt_find_prefix(const struct copt *opt, const struct copt_tab *tab)
+{
+  const struct copt_node *nodes = tab->nodes;
+  int i, k = 0;
+  if (opt->subidx > 0 || opt->namelen == 0)
+    return -1;                  /* only --long options have prefixes */
+  for (i = 0; i < opt->namelen; i++) {
+    unsigned char ch = (unsigned char) opt->name[i];
+    for (k = nodes[k].child; k != 0 && nodes[k].ch != ch; )
+      k = nodes[k].sibling;
+    if (k == 0)
+      return -1;
+  }
+  return nodes[k].id;
+}
+
+/* Return id of optspec in TAB with LEN-byte name NAME, or -1 if none. */
+static int
+copt_tab_find(const struct copt_tab *tab, const char *name, size_t len)
+{
+  const struct copt_slot *slot;
+  size_t h;
+  if (len == 1)
+    return tab->shortid[(unsigned char) *name] - 1;
+  if (tab->nslot > 0) {
+    h = copt_hash(name, len) % tab->nslot;
+    while ((slot = &tab->slots[h])->name != NULL) {
+      if (slot->len == (int) len && !memcmp(slot->name, name, len))
+        return slot->id;
+      h = h+1 < (size_t) tab->nslot ? h+1 : 0;
+    }
+  }
+  return -1;
+}
+
+int
+copt_id(const struct copt *opt, const struct copt_tab *tab)
+{
+  int id;
+  assert(opt->name != NULL || !!!"not option");
+  id = copt_tab_find(tab, opt->name, (size_t) opt->namelen);
+  return id < 0 && tab->nodes ? copt_find_prefix(opt, tab) : id;
+}
+
+int
+copt_subcmd(const struct copt *opt, const struct copt_tab *tab,
+            int reorder, struct copt *sub)
+{
+  int idx = opt->idx < opt->argc ? opt->idx : opt->argc;
+  assert(!opt->stream && !opt->readonly);
+  *sub = copt_init(opt->argc - idx, opt->argv + idx, reorder);
+  sub->noargfn = opt->noargfn;
+  sub->noarg_aux = opt->noarg_aux;
+  sub->badargfn = opt->badargfn;
+  sub->badarg_aux = opt->badarg_aux;
+  if (idx >= opt->argc)
+    return -1;
+  return copt_tab_find(tab, opt->argv[idx], strlen(opt->argv[idx]));
+}
+
+int
+copt_tab_prefix(struct copt_tab *tab, struct copt_node *nodes, int nnode)
+{
+  const struct copt_slot *slot;
+  int i, j, k, used = 1;
+  if (nnode < 1)
+    return -1;
+  nodes[0].child = nodes[0].sibling = 0;
+  nodes[0].id = COPT_AMBIGUOUS; /* root is prefix of everything */
+  for (slot = tab->slots; slot < tab->slots + tab->nslot; slot++) {
+    if (slot->name == NULL)
+      continue;
+    for (i = 0, j = 0; i < slot->len; i++, j = k) {
+      unsigned char ch = (unsigned char) slot->name[i];
+      for (k = nodes[j].child; k != 0 && nodes[k].ch != ch; )
+        k = nodes[k].sibling;
+      if (k != 0) {             /* shared prefix */
+        if (nodes[k].id != slot->id)
+          nodes[k].id = COPT_AMBIGUOUS;
+        continue;
+      }
+      if (used >= nnode)
+        return -1;
+      k = used++;
+      nodes[k].child = 0;
+      nodes[k].sibling = nodes[j].child;
+      nodes[k].id = slot->id;
+      nodes[k].ch = ch;
+      nodes[j].child = k;
+    }
   }
+  tab->nodes = nodes;
   return 0;
 }
 
+/* Return Levenshtein distance between LEN bytes at S and the pattern whose
+   match masks are in PEQ (bit i set in PEQ[c] if pattern[i] == c) and
+   whose length M is 1 to the number of bits in unsigned long.  Give up
+   and return MAXDIST+1 once the distance must exceed MAXDIST.  Uses the
+   bit-parallel algorithm of Myers (1999) as adapted for edit distance by
+   Hyyro (2001), so it takes O(LEN) time with no table to fill. */
+static int
+copt_edit_dist(const unsigned long *peq, int m, const char *s, int len,
+               int maxdist)
+{
+  unsigned long pv = ~0UL, mv = 0, eq, xv, xh, ph, mh;
+  unsigned long hibit = 1UL << (m-1);
+  int i, dist = m;
+  for (i = 0; i < len; i++) {
+    eq = peq[(unsigned char) s[i]];
+    xv = eq | mv;
+    xh = (((eq & pv) + pv) ^ pv) | eq;
+    ph = mv | ~(xh | pv);
+    mh = pv & xh;
+    dist += (ph & hibit) ? 1 : (mh & hibit) ? -1 : 0;
+    if (dist - (len-i-1) > maxdist)
+      return maxdist+1;         /* can't come back within maxdist */
+    ph = (ph << 1) | 1;
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+  }
+  return dist;
+}
+
+int
+copt_suggest(const struct copt *opt, const char *const *specs, int nspec,
+             int maxdist, struct copt_slot *out, int nout)
+{
+  unsigned long peq[256];
+  const char *start, *end;
+  int i, m = opt->namelen, len, dist, best = maxdist, cnt = 0;
+  assert(opt->name != NULL || !!!"not option");
+  if (opt->subidx > 0 || m < 1 || m > (int) (sizeof peq[0] * CHAR_BIT))
+    return 0;
+  memset(peq, 0, sizeof peq);
+  for (i = 0; i < m; i++)
+    peq[(unsigned char) opt->name[i]] |= 1UL << i;
+
+  for (i = 0; i < nspec; i++) {
+    for (start = specs[i]; *start != '\0'; start = end + (*end != '\0')) {
+      for (end = start; *end != '\0' && *end != '|'; end++)
+        continue;
+      len = (int) (end-start);
+      if (len - m > best || m - len > best)
+        continue;               /* length alone puts it too far */
+      if ((dist = copt_edit_dist(peq, m, start, len, best)) > best)
+        continue;
+      if (dist < best)          /* closer than previous names */
+        best = dist, cnt = 0;
+      if (cnt < nout) {
+        out[cnt].name = start;
+        out[cnt].len = len;
+        out[cnt].id = i;
+      }
+      cnt++;
+    }
+  }
+  return cnt < nout ? cnt : nout;
+}
+
 #define COPT_NOARG(opt) ((opt)->noargfn ?                             \
   (opt)->noargfn((opt), (opt)->noarg_aux) :                           \
   (fprintf(stderr, "%s: option '%s' requires argument\n",             \
@@ -257,24 +1119,34 @@ copt_arg_impl(struct copt *opt, int arg_is_optional)
 {
   int subidx = opt->subidx;
   int argidx = opt->argidx;
-  char ch, *eq;
+  char ch;
   opt->subidx = opt->argidx = 0;
 
   if (subidx > 0) {             /* in (possibly grouped) short option */
     if ((ch = opt->argv[opt->idx][subidx+1]) != '\0')
       return opt->argv[opt->idx] + subidx + 1 + (ch == '=');
-  } else if ((eq = strchr(opt->argv[opt->idx], '=')) != NULL)
-    return eq+1;                /* --option=ARG */
+  } else if (opt->name[opt->namelen] == '=')
+    return opt->name + opt->namelen + 1; /* --option=ARG */
   if (arg_is_optional)
     return NULL;                /* optional arg must be in argv[idx] */
+  if (opt->config)
+    return COPT_NOARG(opt);     /* config entry's arg must be in entry */
   if (argidx >= opt->argc)
     return COPT_NOARG(opt);     /* reordered opt, no arg available */
-  if (argidx > opt->idx)        /* reordered opt, arg available */
-    copt_rotate_right(opt->argv + opt->idx + 1, argidx - opt->idx);
+  if (argidx > opt->idx && opt->scratch) {
+    COPT_COUNT_(opt, moved, sizeof *opt->argv);
+    opt->argv[opt->idx+1] = opt->argv[argidx];
+  } else if (argidx > opt->idx) { /* reordered opt, arg available */
+    copt_rotate_right(opt, opt->idx+1, argidx - opt->idx);
+  } else if (opt->reorder && opt->scratch && opt->nscratch > 0) {
+    return COPT_NOARG(opt);     /* slot after opt is a parked non-opt */
+  }
   if (opt->idx+1 >= opt->argc || (opt->argv[opt->idx+1][0] == '-' &&
                                   opt->argv[opt->idx+1][1] != '\0'))
     return COPT_NOARG(opt);     /* not optarg if it's just "-" */
   assert(opt->idx+1 < opt->argc);
+  if (opt->reorder && opt->scratch)
+    opt->next = opt->idx + 2 + opt->nscratch;
   return opt->argv[++opt->idx]; /* optarg is the next argv item */
 }
 
@@ -283,6 +1155,124 @@ char *copt_oarg(struct copt *opt) { return copt_arg_impl(opt, 1); }
 int copt_idx(const struct copt *opt) { return opt->idx; }
 char *copt_curopt(const struct copt *opt) { return opt->curopt; }
 
+/* Convert decimal digits at S to *VAL, and point *END past them.  Return
+   0 on success, or -1 if there are no digits or the value exceeds MAX. */
+static int
+copt_to_ulong(const char *s, unsigned long max, unsigned long *val,
+              const char **end)
+{
+  unsigned long v = 0, d;
+  const char *p;
+  for (p = s; (d = (unsigned char) *p - '0') < 10; p++) {
+    if (v > (max - d) / 10)
+      return -1;
+    v = v*10 + d;
+  }
+  *val = v;
+  *end = p;
+  return p == s ? -1 : 0;
+}
+
+/* Convert S to number of KIND ('i', 'l', 'u', 'd' or 'z') in *VAL, which
+   is only written on success.  Return 0 on success, or -1 on failure. */
+static int
+copt_to_num(const char *s, int kind, void *val)
+{
+  static const char suffix[] = "KMG";
+  unsigned long v, max = kind == 'i' ? INT_MAX :
+                         kind == 'l' ? LONG_MAX : ULONG_MAX;
+  const char *end, *sfx;
+  int sign = kind == 'i' || kind == 'l';
+  int neg = sign && *s == '-';
+  double d;
+  char *dend;
+  if (kind == 'd') {
+    errno = 0;
+    d = strtod(s, &dend);
+    if (dend == s || *dend != '\0' ||
+        (errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL)))
+      return -1;
+    *(double *) val = d;
+    return 0;
+  }
+  s += neg || (sign && *s == '+');
+  if (copt_to_ulong(s, max + neg, &v, &end) != 0)
+    return -1;
+  if (kind == 'z' && *end != '\0' && (sfx = strchr(suffix, *end))) {
+    unsigned long base = end[1] == 'i' ? 1024 : 1000;
+    int n = (int) (sfx - suffix) + 1;
+    for (end += 1 + (end[1] == 'i'); n > 0; n--, v *= base)
+      if (v > max / base)
+        return -1;
+  }
+  if (*end != '\0')
+    return -1;
+  if (kind == 'i')
+    *(int *) val = neg && v > 0 ? -(int) (v-1) - 1 : (int) v;
+  else if (kind == 'l')
+    *(long *) val = neg && v > 0 ? -(long) (v-1) - 1 : (long) v;
+  else if (kind == 'u')
+    *(unsigned long *) val = v;
+  else if ((unsigned long) (size_t) v != v)
+    return -1;
+  else
+    *(size_t *) val = (size_t) v;
+  return 0;
+}
+
+#define COPT_BADARG(opt, arg) ((opt)->badargfn ?                      \
+  (opt)->badargfn((opt), (opt)->badarg_aux) :                         \
+  (fprintf(stderr, "%s: option '%s' has invalid argument '%s'\n",      \
+    COPT_BASENAME((opt)->argv[0]), copt_curopt(opt), (arg)), exit(1),  \
+    (char *) 0))
+
+/* Convert OPT's arg to number of KIND in *VAL, calling badargfn once if
+   the arg isn't valid, and converting what it returns instead.  Set *VAL
+   to 0 if there's no arg or that fails too. */
+static void
+copt_arg_num(struct copt *opt, int kind, void *val)
+{
+  char *arg = copt_arg(opt);
+  if (arg != NULL && copt_to_num(arg, kind, val) == 0)
+    return;
+  if (arg != NULL)
+    arg = COPT_BADARG(opt, arg);
+  if (arg == NULL || copt_to_num(arg, kind, val) != 0)
+    copt_to_num("0", kind, val);
+}
+
+long
+copt_arg_long(struct copt *opt)
+{
+  long val = 0;
+  copt_arg_num(opt, 'l', &val);
+  return val;
+}
+
+unsigned long
+copt_arg_ulong(struct copt *opt)
+{
+  unsigned long val = 0;
+  copt_arg_num(opt, 'u', &val);
+  return val;
+}
+
+double
+copt_arg_double(struct copt *opt)
+{
+  double val = 0;
+  copt_arg_num(opt, 'd', &val);
+  return val;
+}
+
+size_t
+copt_arg_size(struct copt *opt)
+{
+  size_t val = 0;
+  copt_arg_num(opt, 'z', &val);
+  return val;
+}
+
 void
 copt_set_noargfn(struct copt *opt, copt_errfn *noargfn, void *aux)
 {
@@ -290,4 +1280,542 @@ copt_set_noargfn(struct copt *opt, copt_errfn *noargfn, void *aux)
   opt->noarg_aux = aux;
 }
 
+void
+copt_set_badargfn(struct copt *opt, copt_errfn *badargfn, void *aux)
+{
+  opt->badargfn = badargfn;
+  opt->badarg_aux = aux;
+}
+
+void
+copt_set_nonoptfn(struct copt *opt, copt_argfn *nonoptfn, void *aux)
+{
+  opt->nonoptfn = nonoptfn;
+  opt->nonopt_aux = aux;
+  opt->reorder = 0;
+  opt->scratch = NULL;
+}
+
+struct copt
+copt_init_const(int argc, const char *const *argv,
+                const char **nonopts, int cnt)
+{
+  struct copt opt = copt_init(argc, (char **) argv, 0); /* never written */
+  opt.readonly = 1;
+  if (nonopts && cnt >= argc)
+    opt.scratch = (char **) nonopts;
+  return opt;
+}
+
+int
+copt_nonopt_count(const struct copt *opt)
+{
+  return opt->nscratch + (opt->argc - opt->idx);
+}
+
+const char *
+copt_nonopt_at(const struct copt *opt, int i)
+{
+  assert(0 <= i && i < copt_nonopt_count(opt));
+  return i < opt->nscratch ? opt->scratch[i] :
+         opt->argv[opt->idx + i - opt->nscratch];
+}
+
+static char *
+copt_batch_noarg(const struct copt *opt, void *aux)
+{
+  (void) opt, (void) aux;
+  return NULL;
+}
+
+int
+copt_parse_batch(const struct copt_tab *tab, const unsigned char *kinds,
+                 int nline, char *const *const *argvs,
+                 const char **nonopts, int nnonopt,
+                 struct copt_rec *recs, int nrec, int *ends)
+{
+  struct copt opt = copt_init_const(0, NULL, nonopts, 0);
+  int line, i, argc, id, nrec_used = 0;
+  copt_set_noargfn(&opt, copt_batch_noarg, NULL);
+  for (line = 0; line < nline; line++) {
+    char **argv = (char **) argvs[line];   /* never written */
+    int n = nrec_used;
+    for (argc = 0; argv[argc] != NULL; argc++)
+      continue;
+    /* Reset only what a line changes, rather than a whole copt_init(). */
+    opt.argv = argv;
+    opt.argc = argc;
+    opt.idx = opt.subidx = opt.argidx = opt.nscratch = 0;
+    opt.scratch = argc <= nnonopt ? (char **) nonopts : NULL;
+    while (copt_next(&opt)) {
+      if (n >= nrec)
+        return line;
+      id = copt_id(&opt, tab);
+      recs[n].id = id;
+      recs[n].arg = NULL;
+      if (id < 0)
+        recs[n].arg = opt.argv[opt.idx];
+      else if (kinds[id] == COPT_ARG_REQUIRED)
+        recs[n].arg = copt_arg(&opt);
+      else if (kinds[id] == COPT_ARG_OPTIONAL)
+        recs[n].arg = copt_oarg(&opt);
+      n++;
+    }
+    if (n + copt_nonopt_count(&opt) > nrec)
+      return line;
+    for (i = 0; i < copt_nonopt_count(&opt); i++, n++) {
+      recs[n].id = COPT_NONOPT;
+      recs[n].arg = (char *) copt_nonopt_at(&opt, i);
+    }
+    ends[line] = nrec_used = n;
+  }
+  return nline;
+}
+
+int
+copt_tab_bind(struct copt_tab *tab, const struct copt_bind *binds,
+              int nbind, struct copt_slot *slots, int nslot)
+{
+  return copt_tab_build(tab, &binds->spec, sizeof *binds, nbind,
+                        slots, nslot);
+}
+
+int
+copt_bind(struct copt *opt, const struct copt_bind *binds,
+          const struct copt_tab *tab)
+{
+  const struct copt_bind *bind;
+  int id;
+  while (copt_next(opt)) {
+    if ((id = copt_id(opt, tab)) < 0)
+      return 1;
+    switch ((bind = &binds[id])->kind) {
+      case COPT_BIND_FLAG:  *(int *) bind->dst = 1; break;
+      case COPT_BIND_COUNT: ++*(int *) bind->dst; break;
+      case COPT_BIND_STR:   *(char **) bind->dst = copt_arg(opt); break;
+      case COPT_BIND_OSTR:  *(char **) bind->dst = copt_oarg(opt); break;
+      case COPT_BIND_INT:   copt_arg_num(opt, 'i', bind->dst); break;
+      case COPT_BIND_LONG:  copt_arg_num(opt, 'l', bind->dst); break;
+      default:
+        assert(!!!"bad copt_bind kind");
+    }
+  }
+  return 0;
+}
+
+/* Compare name N with LEN bytes at S in copt_names_init()'s order, where
+   short names come before long names.  If PREFIX, compare S as a long
+   name, and treat names S is a prefix of as equal to it. */
+static int
+copt_name_cmp(const struct copt_slot *n, const char *s, int len, int prefix)
+{
+  int c;
+  if ((n->len > 1) != (len > 1 || prefix))
+    return n->len > 1 ? 1 : -1;
+  c = memcmp(n->name, s, n->len < len ? n->len : len);
+  if (c != 0 || (prefix && n->len >= len))
+    return c;
+  return n->len < len ? -1 : n->len > len;
+}
+
+static int
+copt_name_qsort_cmp(const void *a, const void *b)
+{
+  const struct copt_slot *x = (const struct copt_slot *) a;
+  const struct copt_slot *y = (const struct copt_slot *) b;
+  int c = copt_name_cmp(x, y->name, y->len, 0);
+  return c != 0 ? c : x->id < y->id ? -1 : x->id > y->id;
+}
+
+/* Return index of first of NNAME sorted NAMES comparing greater than or
+   equal to (or just greater than, if UPPER) LEN bytes at S. */
+static int
+copt_name_bound(const struct copt_slot *names, int nname, const char *s,
+                int len, int prefix, int upper)
+{
+  int lo = 0, hi = nname, mid, c;
+  while (lo < hi) {
+    mid = lo + (hi-lo) / 2;
+    c = copt_name_cmp(&names[mid], s, len, prefix);
+    if (c < 0 || (upper && c == 0))
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Return id of name in sorted NAMES that is LEN bytes at S, or -1. */
+static int
+copt_name_find(const struct copt_slot *names, int nname, const char *s,
+               int len)
+{
+  int i = copt_name_bound(names, nname, s, len, 0, 0);
+  return i < nname && !copt_name_cmp(&names[i], s, len, 0) ?
+         names[i].id : -1;
+}
+
+int
+copt_names_init(const char *const *specs, int nspec,
+                struct copt_slot *names, int nname)
+{
+  const char *start, *end;
+  int i, j, n = 0;
+  for (i = 0; i < nspec; i++) {
+    for (start = specs[i]; *start != '\0'; start = end + (*end != '\0')) {
+      end = strchr(start, '|');
+      end = end ? end : start + strlen(start);
+      if (end == start)
+        continue;               /* can't complete empty name */
+      if (n >= nname)
+        return -1;
+      names[n].name = start;
+      names[n].len = (int) (end-start);
+      names[n++].id = i;
+    }
+  }
+  qsort(names, n, sizeof *names, copt_name_qsort_cmp);
+  for (i = j = 0; i < n; i++)   /* keep first optspec's copy of name */
+    if (j == 0 || copt_name_cmp(&names[j-1], names[i].name, names[i].len, 0))
+      names[j++] = names[i];
+  return j;
+}
+
+int
+copt_complete(const struct copt_slot *names, int nname,
+              const unsigned char *kinds, int argc, char **argv, int *at)
+{
+  struct copt opt;
+  const char *word, *eq;
+  int base = 0, id, kind;
+  if (argc < 2)
+    return 0;
+  word = argv[argc-1];
+
+  /* Parse the words before WORD, restarting after each non-option so
+     ARGV isn't reordered, to see if WORD is an arg or follows "--". */
+  for (;;) {
+    opt = copt_init(argc-1 - base, argv + base, 0);
+    copt_set_noargfn(&opt, copt_batch_noarg, NULL);
+    while (copt_next(&opt)) {
+      id = copt_name_find(names, nname, opt.name, opt.namelen);
+      kind = id < 0 ? COPT_ARG_NONE : kinds[id];
+      if (kind == COPT_ARG_OPTIONAL) {
+        copt_oarg(&opt);
+      } else if (kind == COPT_ARG_REQUIRED && !copt_arg(&opt) &&
+                 opt.idx == opt.argc-1 && (word[0] != '-' || !word[1])) {
+        *at = id;               /* WORD is arg of last word's option */
+        return COPT_COMPLETE_ARG;
+      }
+    }
+    if (opt.idx > 1 && !strcmp(opt.argv[opt.idx-1], "--"))
+      return 0;                 /* WORD is after "--" */
+    if (opt.idx >= opt.argc)
+      break;
+    base += opt.idx;            /* non-option becomes next argv[0] */
+  }
+
+  if (word[0] != '-')
+    return 0;
+  if (word[1] == '\0') {
+    *at = 0;
+    return nname;
+  }
+  if (word[1] == '-') {         /* --PREFIX or --NAME=ARG */
+    word += 2;
+    if ((eq = strchr(word, '=')) != NULL) {
+      id = copt_name_find(names, nname, word, (int) (eq-word));
+      if (id < 0 || kinds[id] == COPT_ARG_NONE)
+        return 0;
+      *at = id;
+      return COPT_COMPLETE_ARG;
+    }
+    *at = copt_name_bound(names, nname, word, (int) strlen(word), 1, 0);
+    return copt_name_bound(names, nname, word, (int) strlen(word), 1, 1) -
+           *at;
+  }
+  for (word++; *word != '\0'; word++) {  /* group of short options */
+    id = copt_name_find(names, nname, word, 1);
+    if (id >= 0 && kinds[id] != COPT_ARG_NONE && word[1] != '\0') {
+      *at = id;
+      return COPT_COMPLETE_ARG;
+    }
+  }
+  if (word[-2] != '-')
+    return 0;                   /* don't complete several short options */
+  *at = copt_name_bound(names, nname, word-1, 1, 0, 0);
+  return *at < nname && !copt_name_cmp(&names[*at], word-1, 1, 0);
+}
+
+void
+copt_set_scratch(struct copt *opt, char **scratch, int cnt)
+{
+  assert(opt->idx == 0);
+  if (opt->reorder && scratch && cnt >= opt->argc)
+    opt->scratch = scratch;
+}
+
+struct copt_stats
+copt_stats(const struct copt *opt)
+{
+#ifdef COPT_STATS
+  return opt->stats;
+#else
+  struct copt_stats stats;
+  memset(&stats, 0, sizeof stats);
+  (void) opt;
+  return stats;
+#endif
+}
+
+/* Split the next whitespace-separated arg from *S in place, handling
+   quotes and backslashes by POSIX shell rules.  Return the nul-terminated
+   arg, and advance *S past it.  Return NULL if no args remain.  Runs of
+   ordinary bytes are found with strcspn() and moved with memmove(), since
+   libc versions of those are much faster than a byte loop on long
+   strings. */
+static char *
+copt_split_arg(char **s)
+{
+  static const char *const stop[] = {"\\'\" \t\n\v\f\r", "'", "\\\""};
+  char *src = *s, *dst, *arg, quote = '\0';
+  size_t n;
+  src += strspn(src, " \t\n\v\f\r");
+  if (*src == '\0')
+    return *s = src, (char *) NULL;
+  for (arg = dst = src; ; src++) {
+    n = strcspn(src, stop[quote == '\0' ? 0 : quote == '\'' ? 1 : 2]);
+    if (dst != src)
+      memmove(dst, src, n);
+    dst += n, src += n;
+    if (*src == '\0')
+      break;
+    else if (*src == '\\' && src[1] == '\n')
+      src++;                    /* line continuation */
+    else if (*src == '\\' && src[1] != '\0' &&
+             (!quote || strchr("\\\"$`", src[1])))
+      *dst++ = *++src;          /* only these are escaped inside "..." */
+    else if (*src == '\\')
+      *dst++ = *src;
+    else if (*src == quote)
+      quote = '\0';
+    else if (!quote && (*src == '\'' || *src == '"'))
+      quote = *src;
+    else  /* whitespace outside quotes */
+      break;
+  }
+  *s = src + (*src != '\0');
+  *dst = '\0'; /* dst <= src, and file maps have a trailing '\0' */
+  return arg;
+}
+
+int
+copt_split(char *buf, char **argv, int cap)
+{
+  int argc = 0;
+  char *arg;
+  while ((arg = copt_split_arg(&buf)) != NULL) {
+    if (argc >= cap)
+      return -1;
+    argv[argc++] = arg;
+  }
+  if (argc >= cap)
+    return -1;
+  argv[argc] = NULL;
+  return argc;
+}
+
+int
+copt_env(const char *var, int argc, char **argv, char *buf, int bufsize,
+         char **outv, int outcap)
+{
+  const char *val = getenv(var);
+  size_t len = val ? strlen(val) : 0;
+  char *arg;
+  int i, outc = 0, rest = argc > 0 ? argc : 1; /* rest of argv, and NULL */
+  if (len >= (size_t) bufsize || argc >= outcap)
+    return -1;
+  memcpy(buf, val ? val : "", len + 1);
+  if (argc > 0)               /* keep program name first */
+    outv[outc++] = argv[0];
+  while ((arg = copt_split_arg(&buf)) != NULL) {
+    if (outc + rest >= outcap)
+      return -1;
+    outv[outc++] = arg;
+  }
+  for (i = 1; i < argc; i++)
+    outv[outc++] = argv[i];
+  outv[outc] = NULL;
+  return outc;
+}
+
+#ifdef COPT_HAVE_MMAP
+/* Map file at PATH with a trailing '\0' into *MAP.  Return 0 on success. */
+static int
+copt_map_file(struct copt_map *map, const char *path)
+{
+  struct stat st;
+  char *addr = (char *) MAP_FAILED;
+  int zfd, fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    /* Map an extra zeroed page-rounded byte so the last arg in the file
+       can be nul-terminated.  Overlay the file on an anonymous mapping
+       because touching bytes past a page-aligned EOF raises SIGBUS. */
+    map->len = (unsigned long) st.st_size + 1;
+    addr = (char *) mmap(NULL, map->len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | COPT_MAP_ANON_, zfd = COPT_ZERO_FD_, 0);
+    if (zfd >= 0)
+      close(zfd);
+    if (addr != (char *) MAP_FAILED && st.st_size > 0 &&
+        mmap(addr, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      munmap(addr, map->len);
+      addr = (char *) MAP_FAILED;
+    }
+  }
+  close(fd);
+  map->addr = addr == (char *) MAP_FAILED ? NULL : addr;
+  return map->addr ? 0 : -1;
+}
+
+/* True if C is a blank within a config line. */
+#define COPT_BLANK_(c) ((c) == ' ' || (c) == '\t' || \
+                        ((c) >= '\v' && (c) <= '\r'))
+
+/* Rewrite config lines from S in place as entries in OUTV[1...], each
+   nul-terminated.  Return the number of entries, which may be more than
+   fit in OUTCAP-1 items.  Lines are found with strchr(), which libc makes
+   fast, but blanks are skipped by hand, since strspn() sets up a table on
+   every call and lines are short. */
+static int
+copt_config_split(char *s, char **outv, int outcap)
+{
+  char *key, *end, *val, *vend, *eol;
+  int n = 0, eq;
+  for (; *s != '\0'; s = eol) {
+    while (COPT_BLANK_(*s))
+      s++;
+    if ((vend = strchr(s, '\n')) != NULL)
+      eol = vend + 1;
+    else
+      eol = vend = s + strlen(s);
+    if (s == vend || *s == '#')
+      continue;                 /* blank line or comment */
+    for (key = end = s; end < vend && *end != '=' && !COPT_BLANK_(*end); )
+      end++;
+    for (val = end; val < vend && COPT_BLANK_(*val); )
+      val++;
+    val += eq = val < vend && *val == '=';
+    while (val < vend && COPT_BLANK_(*val))
+      val++;
+    while (vend > val && COPT_BLANK_(vend[-1]))
+      vend--;
+    if (val < vend || eq) {
+      *end++ = '=';             /* key, '=', then value shifted down */
+      memmove(end, val, vend - val);
+      end += vend - val;
+    }
+    *end = '\0';                /* end < eol, or map's trailing '\0' */
+    if (++n < outcap)
+      outv[n] = key;
+  }
+  return n;
+}
+#endif
+
+/* Expand ARGC items of ARGV into OUTV[*OUTC...], recursing into "@FILE"
+   args.  Return -1 if out of MAPS, otherwise 0. */
+static int
+copt_expand_args(int argc, char **argv, char **outv, int outcap, int *outc,
+                 struct copt_map *maps, int nmap, int *mapc)
+{
+  int i;
+  for (i = 0; i < argc; i++) {
+#ifdef COPT_HAVE_MMAP
+    struct copt_map map;
+    if (argv[i][0] == '@' && argv[i][1] != '\0' &&
+        copt_map_file(&map, argv[i]+1) == 0) {
+      char *cur, *arg;
+      if (*mapc >= nmap) {
+        munmap(map.addr, map.len);
+        return -1;
+      }
+      maps[(*mapc)++] = map;
+      for (cur = map.addr; (arg = copt_split_arg(&cur)) != NULL; )
+        if (copt_expand_args(1, &arg, outv, outcap, outc,
+                             maps, nmap, mapc) != 0)
+          return -1;
+      continue;
+    }
+#endif
+    if (*outc < outcap)
+      outv[*outc] = argv[i];
+    ++*outc;
+  }
+  (void) maps, (void) nmap, (void) mapc;
+  return 0;
+}
+
+int
+copt_expand(int argc, char **argv, char **outv, int outcap,
+            struct copt_map *maps, int nmap)
+{
+  int i, outc = 0, mapc = 0;
+  for (i = 0; i < nmap; i++)
+    maps[i].addr = NULL;
+  if (argc > 0) {             /* never expand program name */
+    if (outcap > 0)
+      outv[0] = argv[0];
+    outc = 1;
+    if (copt_expand_args(argc-1, argv+1, outv, outcap, &outc,
+                         maps, nmap, &mapc) != 0)
+      return -1;
+  }
+  if (outc < outcap)
+    outv[outc] = NULL;
+  return outc;
+}
+
+int
+copt_config(const char *path, struct copt_map *map, char **outv,
+            int outcap)
+{
+  int n = -1;
+  map->addr = NULL;
+#ifdef COPT_HAVE_MMAP
+  if (copt_map_file(map, path) != 0)
+    return -1;
+  if (outcap > 0)
+    outv[0] = (char *) path;
+  n = 1 + copt_config_split(map->addr, outv, outcap);
+  if (n < outcap)
+    outv[n] = NULL;
+#endif
+  (void) path, (void) outv, (void) outcap;
+  return n;
+}
+
+struct copt
+copt_init_config(int argc, char **argv)
+{
+  struct copt opt = copt_init(argc, argv, 0);
+  opt.config = 1;
+  return opt;
+}
+
+void
+copt_unmap(struct copt_map *maps, int nmap)
+{
+  int i;
+  for (i = 0; i < nmap; i++) {
+#ifdef COPT_HAVE_MMAP
+    if (maps[i].addr)
+      munmap(maps[i].addr, maps[i].len);
+#endif
+    maps[i].addr = NULL;
+  }
+}
+
 #endif /* COPT_IMPL */
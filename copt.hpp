@@ -0,0 +1,182 @@
+/* copt.hpp - compile-time optspec tables for copt in C++14 and later
+   https://github.com/fardaniqbal/copt/
+
+   Optional header-only layer over copt.h.  It splits optspecs at compile
+   time, so matching an option costs one table lookup instead of a chain
+   of copt_opt() calls.  Still no heap allocations, and copt.h's C ABI is
+   unchanged; as usual, do `#define COPT_IMPL` in ONE C or C++ file.
+
+   Example usage:
+
+   constexpr auto opts = coptpp::compile("a", "withducks", "o|outfile");
+   struct copt opt = copt_init(argc, argv, 1);
+   while (copt_next(&opt)) {
+     switch (opts.id(&opt)) {
+       case opts["a"]:         got_a = 1; break;
+       case opts["withducks"]: got_withducks = 1; break;
+       case opts["o|outfile"]: out = copt_arg(&opt); break;
+       default:
+         fprintf(stderr, "unknown option '%s'\n", copt_curopt(&opt));
+         usage();
+     }
+   }
+
+   opts[SPEC] is a compile-time constant, so it fails to compile if SPEC
+   isn't one of the optspecs given to coptpp::compile(). */
+#ifndef COPT_HPP_INCLUDED_
+#define COPT_HPP_INCLUDED_
+#include "copt.h"
+#include <cstddef>
+#include <initializer_list>
+
+#if __cplusplus < 201402L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+# error "copt.hpp requires C++14 or later (copt.h itself works in C++98)"
+#endif
+
+namespace coptpp {
+
+/* Long option name within an optspec, e.g. "outfile" in "o|outfile". */
+struct name {
+  const char *str = nullptr;  /* not nul-terminated */
+  std::size_t len = 0;
+  int id = -1;                /* index of optspec containing this name */
+};
+
+/* Compare LEN bytes like memcmp(), but usable in constant expressions. */
+constexpr int
+cmp(const char *a, const char *b, std::size_t len)
+{
+  for (std::size_t i = 0; i < len; i++)
+    if (a[i] != b[i])
+      return (unsigned char) a[i] < (unsigned char) b[i] ? -1 : 1;
+  return 0;
+}
+
+constexpr bool
+streq(const char *a, const char *b)
+{
+  while (*a != '\0' && *a == *b)
+    a++, b++;
+  return *a == *b;
+}
+
+/* Deliberately not constexpr: reaching it in a constant expression (e.g.
+   a case label) is a compile error. */
+inline int unknown_optspec() { return -1; }
+
+/* Optspecs compiled into lookup tables.  NSPEC is the number of optspecs,
+   NNAME bounds the number of long names, and MAXLEN bounds their length.
+   Long names are sorted by length, then by bytes, so a lookup only binary
+   searches names of the same length. */
+template <std::size_t NSPEC, std::size_t NNAME, std::size_t MAXLEN>
+struct table {
+  const char *specs[NSPEC] = {};
+  name names[NNAME] = {};
+  std::size_t nname = 0;
+  std::size_t lenbeg[MAXLEN+2] = {}; /* names[lenbeg[n]] is 1st of len n */
+  int shortid[256] = {};             /* 1 + id of short option char */
+
+  /* Return id of optspec SPEC, which must be one given to compile(). */
+  constexpr int operator[](const char *spec) const {
+    for (std::size_t i = 0; i < NSPEC; i++)
+      if (streq(specs[i], spec))
+        return (int) i;
+    return unknown_optspec();
+  }
+
+  /* Return id of optspec whose name is LEN bytes at S, or -1. */
+  constexpr int find(const char *s, std::size_t len) const {
+    std::size_t lo = 0, hi = 0;
+    if (len == 1)
+      return shortid[(unsigned char) *s] - 1;
+    if (len > MAXLEN)
+      return -1;
+    for (lo = lenbeg[len], hi = lenbeg[len+1]; lo < hi; ) {
+      std::size_t mid = lo + (hi-lo) / 2;
+      int c = cmp(s, names[mid].str, len);
+      if (c == 0)
+        return names[mid].id;
+      if (c < 0)
+        hi = mid;
+      else
+        lo = mid+1;
+    }
+    return -1;
+  }
+
+  /* After copt_next() indicates more options remain, return the id of the
+     first optspec matching the current option, or -1 if none match.  Same
+     result as calling copt_opt() on each optspec in order. */
+  int id(const struct copt *opt) const {
+    return find(opt->name, (std::size_t) opt->namelen); /* from copt_next() */
+  }
+
+  /* Add LEN-byte name S from optspec ID unless an earlier one has it. */
+  constexpr void add(const char *s, std::size_t len, int id) {
+    std::size_t i = 0, j = 0;
+    if (len == 1) {
+      if (shortid[(unsigned char) *s] == 0)
+        shortid[(unsigned char) *s] = id+1;
+      return;
+    }
+    for (i = 0; i < nname; i++) {
+      int c = len != names[i].len ? (len < names[i].len ? -1 : 1) :
+              cmp(s, names[i].str, len);
+      if (c == 0)
+        return;
+      if (c < 0)
+        break;
+    }
+    for (j = nname++; j > i; j--)
+      names[j] = names[j-1];
+    names[i].str = s;
+    names[i].len = len;
+    names[i].id = id;
+  }
+};
+
+constexpr std::size_t
+sum(std::initializer_list<std::size_t> v)
+{
+  std::size_t n = 0;
+  for (std::size_t x : v)
+    n += x;
+  return n;
+}
+
+constexpr std::size_t
+max(std::initializer_list<std::size_t> v)
+{
+  std::size_t n = 0;
+  for (std::size_t x : v)
+    n = n < x ? x : n;
+  return n;
+}
+
+/* Compile optspec string literals SPECS into a table. */
+template <std::size_t... LENS>
+constexpr table<sizeof...(LENS), sum({LENS...}), max({LENS...})>
+compile(const char (&...specs)[LENS])
+{
+  table<sizeof...(LENS), sum({LENS...}), max({LENS...})> tab{};
+  const char *ptrs[] = {specs...};
+  std::size_t i = 0, n = 0;
+  for (i = 0; i < sizeof...(LENS); i++) {
+    const char *start = ptrs[i], *end = start;
+    tab.specs[i] = ptrs[i];
+    for (; *start != '\0'; start = end + (*end != '\0')) {
+      for (end = start; *end != '\0' && *end != '|'; end++)
+        continue;
+      tab.add(start, (std::size_t) (end-start), (int) i);
+    }
+  }
+  for (i = n = 0; n <= max({LENS...}) + 1; n++) {
+    while (i < tab.nname && tab.names[i].len < n)
+      i++;
+    tab.lenbeg[n] = i;
+  }
+  return tab;
+}
+
+} /* namespace coptpp */
+#endif /* COPT_HPP_INCLUDED_ */